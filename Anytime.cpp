@@ -0,0 +1,117 @@
+#include "Anytime.hpp"
+#include "Evaluator.hpp"
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+AnytimeSearch::AnytimeSearch(shared_ptr<const Roster> roster, int team_size, bool prioritize_skills)
+    : roster(roster), team_size(team_size), prioritize_skills(prioritize_skills) {
+}
+
+AnytimeSearch::~AnytimeSearch() {
+    cancel();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void AnytimeSearch::start(bool prioritize_preferences, const AnytimeOptions& options, const CancellationToken& token) {
+    if (worker.joinable()) {
+        cancel();
+        worker.join();
+    }
+    cancellation = token;
+    current = AnytimeProgress();
+    result = AnytimeResult();
+    finished.store(false, memory_order_release);
+    worker = thread(&AnytimeSearch::run, this, prioritize_preferences, options);
+}
+
+AnytimeProgress AnytimeSearch::progress() const {
+    lock_guard<mutex> lock(progress_mutex);
+    return current;
+}
+
+AnytimeResult AnytimeSearch::wait() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+    return move(result);
+}
+
+void AnytimeSearch::run(bool prioritize_preferences, AnytimeOptions options) {
+    auto start = chrono::steady_clock::now();
+    auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                chrono::duration<double>(options.time_limit_seconds));
+    auto stopped = [&]() { return cancellation.cancelled() || chrono::steady_clock::now() >= deadline; };
+    auto secondsLeft = [&]() {
+        return max(0.0, chrono::duration<double>(deadline - chrono::steady_clock::now()).count());
+    };
+
+    AnytimeProgress progress;
+    AssignmentEvaluator evaluator(*roster);
+    // Every round is scored by the evaluator, whose objective also charges unassigned students, so a
+    // formation that leaves students out never outranks an annealed layout by the optimizer's measure
+    auto score = [&](const vector<vector<uint32_t>>& teams) {
+        return evaluator.evaluate(encodeAssignment(teams, roster->size())).objective(optimizer_options);
+    };
+    // One formation, bounded by what is left of the deadline; seed 0 is the plain deterministic pass
+    auto form = [&](uint64_t seed) {
+        TeamBuilder builder(roster, team_size, prioritize_skills);
+        builder.setVerbose(false);
+        SolverBudget budget = solver_budget;
+        budget.time_limit_seconds = min(budget.time_limit_seconds, secondsLeft());
+        budget.cancellation = cancellation;
+        builder.setSolverBudget(budget);
+        builder.setFormationSeed(seed);
+        AnytimeResult formed;
+        formed.status = builder.formTeams(prioritize_preferences);
+        formed.teams = builder.teamMembers();
+        formed.unassigned = builder.unassignedStudents();
+        formed.score = score(formed.teams);
+        return formed;
+    };
+
+    AnytimeResult best = form(0);
+    while (true) {
+        ++progress.rounds;
+        progress.best_score = best.score;
+        progress.best_unassigned = best.unassigned.size();
+        progress.elapsed_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        {
+            lock_guard<mutex> lock(progress_mutex);
+            current = progress;
+        }
+        if (options.on_progress) {
+            options.on_progress(progress);
+        }
+        // Infeasibility is proven for the roster, not the order, so no other round can do better
+        if (stopped() || best.status == FormationStatus::Infeasible) break;
+
+        uint64_t seed = options.seed + progress.rounds - 1;
+        AnytimeResult candidate;
+        if (!best.unassigned.empty()) {
+            // Annealing cannot place unassigned students, so try another formation order instead
+            candidate = form(seed);
+        } else {
+            candidate.status = best.status;
+            candidate.teams = best.teams;
+            OptimizerOptions round_options = optimizer_options;
+            round_options.seed = seed;
+            LocalSearchOptimizer optimizer(*roster, round_options);
+            optimizer.setStopCheck(stopped);
+            optimizer.optimize(candidate.teams);
+            progress.iterations += optimizer.iterationsRun();
+            candidate.score = score(candidate.teams);
+        }
+        if (candidate.score > best.score) {
+            best = move(candidate);
+        }
+    }
+
+    best.progress = progress;
+    best.cancelled = cancellation.cancelled();
+    result = move(best);
+    finished.store(true, memory_order_release);
+}
@@ -0,0 +1,81 @@
+#ifndef ANYTIME_HPP
+#define ANYTIME_HPP
+
+#include "TeamBuilder.hpp"
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Snapshot of a running anytime search
+struct AnytimeProgress {
+    uint64_t iterations = 0;  // Optimizer moves tried, over every round
+    uint64_t rounds = 0;      // Formations and optimizer restarts finished
+    double best_score = 0.0;
+    size_t best_unassigned = 0;
+    double elapsed_seconds = 0.0;
+};
+
+struct AnytimeOptions {
+    double time_limit_seconds = 1.0;  // Deadline, measured from start()
+    uint64_t seed = 1;                // Later rounds use the seeds that follow
+    // Called on the search thread after every round
+    std::function<void(const AnytimeProgress&)> on_progress;
+};
+
+struct AnytimeResult {
+    FormationStatus status = FormationStatus::Infeasible;
+    double score = 0.0;
+    std::vector<std::vector<uint32_t>> teams;
+    std::vector<uint32_t> unassigned;
+    AnytimeProgress progress;
+    bool cancelled = false;  // Stopped by the token rather than the deadline
+};
+
+// Formation with a deadline, on a background thread. One full formation runs first, then rounds
+// of annealing restarts from the best assignment so far (or fresh seeded formations while
+// students are left unassigned) until the deadline passes or the token is cancelled. The result
+// is the best assignment any round produced, scored as in the portfolio search. Only the first
+// formation's greedy pass cannot be interrupted; its repair stops at the deadline like the rest.
+class AnytimeSearch {
+public:
+    AnytimeSearch(std::shared_ptr<const Roster> roster, int team_size, bool prioritize_skills);
+    // Cancels and joins a search that is still running
+    ~AnytimeSearch();
+    AnytimeSearch(const AnytimeSearch&) = delete;
+    AnytimeSearch& operator=(const AnytimeSearch&) = delete;
+
+    void setSolverBudget(const SolverBudget& budget) { solver_budget = budget; }
+    // Weights, temperatures and per-round iterations for the annealing rounds
+    void setOptimizerOptions(const OptimizerOptions& options) { optimizer_options = options; }
+
+    // Returns at once; a search already running is cancelled and joined first
+    void start(bool prioritize_preferences, const AnytimeOptions& options,
+               const CancellationToken& cancellation = CancellationToken());
+    void cancel() { cancellation.cancel(); }
+    bool done() const { return finished.load(std::memory_order_acquire); }
+    AnytimeProgress progress() const;
+    // Blocks until the search stops and hands over its result
+    AnytimeResult wait();
+
+private:
+    std::shared_ptr<const Roster> roster;
+    int team_size;
+    bool prioritize_skills;
+    SolverBudget solver_budget;
+    OptimizerOptions optimizer_options;
+
+    std::thread worker;
+    CancellationToken cancellation;
+    std::atomic<bool> finished{true};
+    mutable std::mutex progress_mutex;
+    AnytimeProgress current;
+    AnytimeResult result;
+
+    void run(bool prioritize_preferences, AnytimeOptions options);
+};
+
+#endif // ANYTIME_HPP
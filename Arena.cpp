@@ -0,0 +1,42 @@
+#include "Arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~uintptr_t(alignment - 1);
+    if (cursor != nullptr && aligned + bytes <= reinterpret_cast<uintptr_t>(limit)) {
+        cursor = reinterpret_cast<char*>(aligned + bytes);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // Requests bigger than a quarter block get a block of their own, leaving the current one open
+    size_t needed = bytes + alignment;
+    if (needed > next_block / 4) {
+        blocks.emplace_back(new char[needed]);
+        reserved += needed;
+        uintptr_t start = reinterpret_cast<uintptr_t>(blocks.back().get());
+        return reinterpret_cast<void*>((start + alignment - 1) & ~uintptr_t(alignment - 1));
+    }
+
+    // Blocks double up to kMaxBlockBytes, so small rosters stay small and large ones take few blocks
+    blocks.emplace_back(new char[next_block]);
+    reserved += next_block;
+    cursor = blocks.back().get();
+    limit = cursor + next_block;
+    next_block = min(next_block * 2, kMaxBlockBytes);
+    return allocate(bytes, alignment);
+}
+
+void Arena::adopt(Arena&& other) {
+    blocks.reserve(blocks.size() + other.blocks.size());
+    for (auto& block : other.blocks) {
+        blocks.push_back(move(block));
+    }
+    reserved += other.reserved;
+    other.blocks.clear();
+    other.cursor = nullptr;
+    other.limit = nullptr;
+    other.reserved = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include "Student.hpp"
+#include <vector>
+#include <memory>
+#include <string_view>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+
+// Monotonic allocator: requests are carved from large blocks in order and nothing is freed until
+// the arena itself is destroyed, so a roster's strings and lists cost a handful of allocations
+// and one release. Blocks never move, so pointers into an arena survive moving the arena.
+class Arena {
+public:
+    static const size_t kFirstBlockBytes = 16 * 1024;
+    static const size_t kMaxBlockBytes = 1024 * 1024;
+
+    Arena() = default;
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment);
+
+    // Uninitialised room for `count` values; only for types with no destructor to run
+    template <typename T>
+    T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    std::string_view copy(std::string_view text) {
+        if (text.empty()) return std::string_view();
+        char* bytes = allocateArray<char>(text.size());
+        memcpy(bytes, text.data(), text.size());
+        return std::string_view(bytes, text.size());
+    }
+
+    template <typename T>
+    Span<T> copy(const T* values, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "arena copies are plain memory copies");
+        if (count == 0) return Span<T>();
+        T* copied = allocateArray<T>(count);
+        memcpy(static_cast<void*>(copied), values, count * sizeof(T));
+        return Span<T>(copied, count);
+    }
+
+    // Take over another arena's blocks, e.g. one filled by a parser thread
+    void adopt(Arena&& other);
+
+    size_t bytesReserved() const { return reserved; }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t next_block = kFirstBlockBytes;
+    size_t reserved = 0;
+};
+
+#endif // ARENA_HPP
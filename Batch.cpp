@@ -0,0 +1,218 @@
+#include "Batch.hpp"
+#include "TeamBuilder.hpp"
+#include "WorkQueue.hpp"
+#include "Utilities.hpp"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+double millisecondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+struct ParseItem {
+    string roster_file;
+    vector<size_t> jobs;
+};
+
+struct BuildItem {
+    size_t job;
+    shared_ptr<const Roster> roster;
+};
+
+struct WriteItem {
+    size_t job;
+    unique_ptr<TeamBuilder> builder;
+};
+
+} // namespace
+
+vector<BatchJob> readManifest(const string& filename, vector<ParseError>& errors) {
+    vector<BatchJob> jobs;
+    ifstream file(filename);
+    if (!file.is_open()) {
+        errors.push_back({0, "cannot open manifest " + filename});
+        return jobs;
+    }
+
+    string line;
+    size_t line_number = 0;
+    while (getline(file, line)) {
+        ++line_number;
+        string_view rest = trimView(line);
+        if (rest.empty() || rest[0] == '#') continue;
+
+        string_view fields[4];
+        size_t count = 0;
+        while (count < 4) {
+            size_t pos = rest.find(',');
+            fields[count++] = trimView(rest.substr(0, pos));
+            if (pos == string_view::npos) break;
+            rest = rest.substr(pos + 1);
+        }
+        if (count != 4 || fields[0].empty() || fields[3].empty()) {
+            errors.push_back({line_number, "expected roster,team_size,mode,output"});
+            continue;
+        }
+
+        BatchJob job;
+        job.roster_file = string(fields[0]);
+        job.output_file = string(fields[3]);
+        job.output_format = teamFormatForFile(job.output_file);
+        string mode;
+        appendLowerCase(mode, fields[2]);
+        if (!parseNumber(string(fields[1]), job.team_size)) {
+            errors.push_back({line_number, "invalid team size: " + string(fields[1])});
+            continue;
+        }
+        if (job.team_size < 2) {
+            errors.push_back({line_number, "team size must be at least 2"});
+            continue;
+        }
+        if (mode == "preferences" || mode == "1") {
+            job.prioritize_preferences = true;
+        } else if (mode == "skills" || mode == "0") {
+            job.prioritize_preferences = false;
+        } else {
+            errors.push_back({line_number, "mode must be preferences or skills"});
+            continue;
+        }
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+vector<BatchJobResult> runBatch(const vector<BatchJob>& jobs, unsigned workers, const OptimizerOptions& optimizer_options,
+                                const ExactOptions& exact_options, const DecompositionOptions& decomposition_options,
+                                const SnapshotOptions& snapshot_options) {
+    vector<BatchJobResult> results(jobs.size());
+    if (workers == 0) {
+        workers = max(1u, thread::hardware_concurrency());
+    }
+    // Building dominates, so it gets most of the pool; every stage gets at least one thread
+    unsigned parse_threads = max(1u, workers / 4);
+    unsigned write_threads = max(1u, workers / 8);
+    unsigned build_threads = max(1u, workers > parse_threads + write_threads ? workers - parse_threads - write_threads : 1u);
+
+    // Jobs that name the same roster share one parse
+    map<string, vector<size_t>> by_roster;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        by_roster[jobs[i].roster_file].push_back(i);
+    }
+
+    WorkQueue<ParseItem> parse_queue(by_roster.size());
+    WorkQueue<BuildItem> build_queue(build_threads * 2);
+    WorkQueue<WriteItem> write_queue(write_threads * 2);
+
+    auto parse_stage = [&]() {
+        ParseItem item;
+        while (parse_queue.pop(item)) {
+            auto start = chrono::steady_clock::now();
+            RosterLoad load = loadRoster(item.roster_file, 1, snapshot_options);
+            double elapsed = millisecondsSince(start);
+
+            for (size_t job : item.jobs) {
+                BatchJobResult& result = results[job];
+                result.parse_ms = elapsed;
+                result.skipped_rows = load.errors.size();
+                result.students = load.students;
+                if (!load.opened) {
+                    result.status = "cannot open roster";
+                } else if (!load.roster) {
+                    result.status = "no students";
+                } else {
+                    build_queue.push({job, load.roster});
+                }
+            }
+        }
+    };
+
+    auto build_stage = [&]() {
+        BuildItem item;
+        while (build_queue.pop(item)) {
+            const BatchJob& job = jobs[item.job];
+            BatchJobResult& result = results[item.job];
+            auto start = chrono::steady_clock::now();
+            unique_ptr<TeamBuilder> builder(new TeamBuilder(item.roster, job.team_size, !job.prioritize_preferences));
+            builder->setVerbose(false);
+            builder->setOptimizerOptions(optimizer_options);
+            builder->setExactOptions(exact_options);
+            builder->setDecompositionOptions(decomposition_options);
+            FormationStatus status = builder->formTeams(job.prioritize_preferences);
+            result.build_ms = millisecondsSince(start);
+            result.teams = builder->teamMembers().size();
+
+            if (status == FormationStatus::Infeasible) {
+                result.status = "infeasible";
+            } else {
+                result.status = status == FormationStatus::BudgetExhausted ? "budget exhausted" : "ok";
+                write_queue.push({item.job, move(builder)});
+            }
+        }
+    };
+
+    auto write_stage = [&]() {
+        WriteItem item;
+        while (write_queue.pop(item)) {
+            BatchJobResult& result = results[item.job];
+            auto start = chrono::steady_clock::now();
+            WriteResult written = item.builder->writeTeamsToFile(jobs[item.job].output_file, jobs[item.job].output_format);
+            if (written.ok) {
+                result.ok = result.status == "ok";
+            } else {
+                result.status = "write failed";
+                result.error = written.error;
+            }
+            result.write_ms = millisecondsSince(start);
+        }
+    };
+
+    vector<thread> parsers, builders, writers;
+    for (unsigned i = 0; i < parse_threads; ++i) parsers.emplace_back(parse_stage);
+    for (unsigned i = 0; i < build_threads; ++i) builders.emplace_back(build_stage);
+    for (unsigned i = 0; i < write_threads; ++i) writers.emplace_back(write_stage);
+
+    for (auto& entry : by_roster) {
+        parse_queue.push({entry.first, entry.second});
+    }
+
+    // Shut the pipeline down stage by stage so every queued item is drained
+    parse_queue.close();
+    for (auto& t : parsers) t.join();
+    build_queue.close();
+    for (auto& t : builders) t.join();
+    write_queue.close();
+    for (auto& t : writers) t.join();
+
+    return results;
+}
+
+void printBatchSummary(const vector<BatchJob>& jobs, const vector<BatchJobResult>& results) {
+    size_t succeeded = 0;
+    cout << left << setw(5) << "Job" << setw(18) << "Status" << right << setw(10) << "Students" << setw(8) << "Teams"
+         << setw(10) << "Parse ms" << setw(10) << "Build ms" << setw(10) << "Write ms" << "  Output\n";
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const BatchJobResult& r = results[i];
+        if (r.ok) ++succeeded;
+        cout << left << setw(5) << i + 1 << setw(18) << r.status << right << setw(10) << r.students << setw(8) << r.teams
+             << fixed << setprecision(2) << setw(10) << r.parse_ms << setw(10) << r.build_ms << setw(10) << r.write_ms
+             << "  " << jobs[i].output_file;
+        if (r.skipped_rows > 0) {
+            cout << " (" << r.skipped_rows << " row(s) skipped)";
+        }
+        if (!r.error.empty()) {
+            cout << " (" << r.error << ")";
+        }
+        cout << "\n";
+    }
+    cout << succeeded << " of " << jobs.size() << " job(s) succeeded." << endl;
+}
@@ -0,0 +1,52 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "Optimizer.hpp"
+#include "ExactSolver.hpp"
+#include "Decomposition.hpp"
+#include "RosterSnapshot.hpp"
+#include "TeamWriter.hpp"
+#include <vector>
+#include <string>
+
+// One line of a batch manifest
+struct BatchJob {
+    std::string roster_file;
+    int team_size = 0;
+    bool prioritize_preferences = true;
+    std::string output_file;
+    TeamFormat output_format = TeamFormat::Csv;
+};
+
+struct BatchJobResult {
+    bool ok = false;
+    std::string status;
+    std::string error;  // Why the output could not be written
+    size_t students = 0;
+    size_t teams = 0;
+    size_t skipped_rows = 0;
+    double parse_ms = 0.0;  // Shared by every job that names the same roster
+    double build_ms = 0.0;
+    double write_ms = 0.0;
+};
+
+// Manifest format: one job per line, "roster,team_size,mode,output", where mode
+// is "preferences" or "skills". The output format follows the output file's extension
+// (.json, .bin, otherwise CSV). Blank lines and lines starting with '#' are
+// ignored. Bad lines are reported in `errors` and left out of the job list.
+std::vector<BatchJob> readManifest(const std::string& filename, std::vector<ParseError>& errors);
+
+// Runs the jobs through a parse -> build -> write pipeline. `workers` (0 = every core)
+// is split across the three stages, but each stage always gets at least one thread,
+// so fewer than three workers still runs three; decomposed builds add their own
+// `decomposition_options.threads` on top. Each distinct roster file is parsed once
+// and shared read-only by all of its jobs. Never reads stdin. Results are in job order.
+std::vector<BatchJobResult> runBatch(const std::vector<BatchJob>& jobs, unsigned workers,
+                                     const OptimizerOptions& optimizer_options,
+                                     const ExactOptions& exact_options = ExactOptions(),
+                                     const DecompositionOptions& decomposition_options = DecompositionOptions(),
+                                     const SnapshotOptions& snapshot_options = SnapshotOptions());
+
+void printBatchSummary(const std::vector<BatchJob>& jobs, const std::vector<BatchJobResult>& results);
+
+#endif // BATCH_HPP
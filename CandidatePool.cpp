@@ -0,0 +1,60 @@
+#include "CandidatePool.hpp"
+
+using namespace std;
+
+CandidatePool::CandidatePool(const Roster& roster, const vector<uint32_t>& order)
+    : roster(roster), position(roster.size(), kNoStudent), prev_id(roster.size(), kNoStudent),
+      next_id(roster.size(), kNoStudent), pref_prev(roster.size(), kNoStudent), pref_next(roster.size(), kNoStudent),
+      has_preferences(roster.size(), 0) {
+    reset(order);
+}
+
+void CandidatePool::reset(const vector<uint32_t>& new_order) {
+    for (uint32_t id : order) {
+        position[id] = prev_id[id] = next_id[id] = pref_prev[id] = pref_next[id] = kNoStudent;
+        has_preferences[id] = 0;
+    }
+    order = new_order;
+    count = order.size();
+    head = tail = pref_head = kNoStudent;
+
+    uint32_t pref_tail = kNoStudent;
+    for (size_t i = 0; i < order.size(); ++i) {
+        uint32_t id = order[i];
+        position[id] = static_cast<uint32_t>(i);
+        prev_id[id] = tail;
+        if (tail == kNoStudent) head = id; else next_id[tail] = id;
+        tail = id;
+
+        if (!roster.student(id).want_to_work_with.empty()) {
+            has_preferences[id] = 1;
+            pref_prev[id] = pref_tail;
+            if (pref_tail == kNoStudent) pref_head = id; else pref_next[pref_tail] = id;
+            pref_tail = id;
+        }
+    }
+}
+
+void CandidatePool::remove(uint32_t id) {
+    if (!contains(id)) return;
+
+    if (prev_id[id] == kNoStudent) head = next_id[id]; else next_id[prev_id[id]] = next_id[id];
+    if (next_id[id] == kNoStudent) tail = prev_id[id]; else prev_id[next_id[id]] = prev_id[id];
+
+    if (has_preferences[id]) {
+        if (pref_prev[id] == kNoStudent) pref_head = pref_next[id]; else pref_next[pref_prev[id]] = pref_next[id];
+        if (pref_next[id] != kNoStudent) pref_prev[pref_next[id]] = pref_prev[id];
+    }
+
+    position[id] = kNoStudent;
+    --count;
+}
+
+vector<uint32_t> CandidatePool::remaining() const {
+    vector<uint32_t> ids;
+    ids.reserve(count);
+    for (uint32_t id = head; id != kNoStudent; id = next_id[id]) {
+        ids.push_back(id);
+    }
+    return ids;
+}
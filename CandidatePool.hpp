@@ -0,0 +1,55 @@
+#ifndef CANDIDATEPOOL_HPP
+#define CANDIDATEPOOL_HPP
+
+#include "Roster.hpp"
+#include <vector>
+#include <cstdint>
+
+// Students still waiting for a team, kept in the order formation visits them.
+// A doubly linked list threaded through roster IDs gives O(1) removal without
+// disturbing that order; a second list links the students who listed preferences.
+class CandidatePool {
+public:
+    CandidatePool(const Roster& roster, const std::vector<uint32_t>& order);
+    // Refill with a new order, reusing the ID-indexed arrays; costs the old and new orders' lengths
+    void reset(const std::vector<uint32_t>& new_order);
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    bool contains(uint32_t id) const { return position[id] != kNoStudent; }
+    // Where a remaining student sits in the order the pool was filled with, below orderSize()
+    uint32_t indexOf(uint32_t id) const { return position[id]; }
+    size_t orderSize() const { return order.size(); }
+    void remove(uint32_t id);
+
+    // Each returns kNoStudent when there is no such student
+    uint32_t front() const { return head; }
+    uint32_t next(uint32_t id) const { return next_id[id]; }
+    uint32_t frontWithPreferences() const { return pref_head; }
+    uint32_t nextWithPreferences(uint32_t id) const { return pref_next[id]; }
+
+    // First remaining student, in order, that `accept` takes
+    template <typename Accept>
+    uint32_t findFirst(Accept accept) const {
+        for (uint32_t id = head; id != kNoStudent; id = next_id[id]) {
+            if (accept(id)) return id;
+        }
+        return kNoStudent;
+    }
+
+    // The remaining students, in order
+    std::vector<uint32_t> remaining() const;
+
+private:
+    const Roster& roster;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> position;  // Index into `order`, or kNoStudent once removed
+    std::vector<uint32_t> prev_id, next_id;
+    std::vector<uint32_t> pref_prev, pref_next;  // kNoStudent links for students without preferences
+    std::vector<char> has_preferences;
+    uint32_t head = kNoStudent, tail = kNoStudent;
+    uint32_t pref_head = kNoStudent;
+    size_t count = 0;
+};
+
+#endif // CANDIDATEPOOL_HPP
@@ -0,0 +1,96 @@
+#include "Decomposition.hpp"
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+DisjointSets::DisjointSets(uint32_t count) : parent(count), set_size(count, 1) {
+    iota(parent.begin(), parent.end(), 0);
+}
+
+uint32_t DisjointSets::find(uint32_t id) {
+    while (parent[id] != id) {
+        parent[id] = parent[parent[id]];
+        id = parent[id];
+    }
+    return id;
+}
+
+void DisjointSets::unite(uint32_t a, uint32_t b) {
+    a = find(a);
+    b = find(b);
+    if (a == b) return;
+    if (set_size[a] < set_size[b]) swap(a, b);
+    parent[b] = a;
+    set_size[a] += set_size[b];
+}
+
+vector<vector<uint32_t>> connectedComponents(const Roster& roster, vector<uint32_t>& unconstrained) {
+    uint32_t n = roster.size();
+    DisjointSets sets(n);
+    // wanted_by and the conflict lists' back edges mirror these, so one direction is enough
+    for (uint32_t id = 0; id < n; ++id) {
+        for (uint32_t other : roster.wants(id)) {
+            sets.unite(id, other);
+        }
+        for (uint32_t other : roster.conflicts(id)) {
+            if (other > id) sets.unite(id, other);
+        }
+    }
+
+    // Number the components by their lowest member, so the order does not depend on the merges
+    vector<uint32_t> component_of(n, kNoStudent);
+    vector<vector<uint32_t>> components;
+    unconstrained.clear();
+    for (uint32_t id = 0; id < n; ++id) {
+        uint32_t root = sets.find(id);
+        if (sets.sizeOf(root) == 1) {
+            unconstrained.push_back(id);
+            continue;
+        }
+        if (component_of[root] == kNoStudent) {
+            component_of[root] = static_cast<uint32_t>(components.size());
+            components.emplace_back();
+            components.back().reserve(sets.sizeOf(root));
+        }
+        components[component_of[root]].push_back(id);
+    }
+    stable_sort(components.begin(), components.end(), [](const vector<uint32_t>& a, const vector<uint32_t>& b) {
+        return a.size() > b.size();
+    });
+    return components;
+}
+
+vector<vector<uint32_t>> groupComponents(const vector<vector<uint32_t>>& components, size_t group_size,
+                                         size_t team_size, vector<uint32_t>& unconstrained) {
+    vector<vector<uint32_t>> groups;
+    // Groups are only ever tried from the first one that still has room
+    size_t first_open = 0;
+    for (const auto& component : components) {
+        size_t target = groups.size();
+        for (size_t g = first_open; g < groups.size(); ++g) {
+            if (groups[g].size() + component.size() <= group_size) {
+                target = g;
+                break;
+            }
+        }
+        if (target == groups.size()) {
+            groups.emplace_back();
+        }
+        groups[target].insert(groups[target].end(), component.begin(), component.end());
+        while (first_open < groups.size() && groups[first_open].size() + 2 > group_size) {
+            ++first_open;
+        }
+    }
+
+    // Unconstrained students round each group up so it splits into whole teams
+    size_t next_free = 0;
+    for (auto& group : groups) {
+        size_t short_by = (team_size - group.size() % team_size) % team_size;
+        for (; short_by > 0 && next_free < unconstrained.size(); --short_by) {
+            group.push_back(unconstrained[next_free++]);
+        }
+    }
+    unconstrained.erase(unconstrained.begin(), unconstrained.begin() + next_free);
+    return groups;
+}
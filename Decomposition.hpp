@@ -0,0 +1,42 @@
+#ifndef DECOMPOSITION_HPP
+#define DECOMPOSITION_HPP
+
+#include "Roster.hpp"
+#include <vector>
+#include <cstdint>
+
+// Splitting a roster into independent subproblems: students joined by no chain of
+// preference or conflict edges never constrain each other's teams, so each connected
+// component can be formed on its own and the results merged
+struct DecompositionOptions {
+    bool enabled = false;
+    unsigned threads = 0;  // 0 uses every available core
+};
+
+// Union-find over student IDs with union by size and path halving
+class DisjointSets {
+public:
+    explicit DisjointSets(uint32_t count);
+    uint32_t find(uint32_t id);
+    void unite(uint32_t a, uint32_t b);
+    uint32_t sizeOf(uint32_t id) { return set_size[find(id)]; }
+
+private:
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> set_size;
+};
+
+// Connected components of the combined want_to_work_with and dont_want_to_work_with graph,
+// largest first (ties by lowest ID), each listing its members in ID order. Students with no
+// edges are not components; they are returned in `unconstrained`.
+std::vector<std::vector<uint32_t>> connectedComponents(const Roster& roster, std::vector<uint32_t>& unconstrained);
+
+// Bin-pack components, largest first, into groups of about `group_size` students: each goes
+// to the first group with room, and one larger than `group_size` gets a group to itself.
+// Groups are then padded to a multiple of `team_size` from `unconstrained`, which keeps the
+// students left over.
+std::vector<std::vector<uint32_t>> groupComponents(const std::vector<std::vector<uint32_t>>& components,
+                                                   size_t group_size, size_t team_size,
+                                                   std::vector<uint32_t>& unconstrained);
+
+#endif // DECOMPOSITION_HPP
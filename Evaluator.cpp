@@ -0,0 +1,237 @@
+#include "Evaluator.hpp"
+#include "TeamSize.hpp"
+#include "TeamWriter.hpp"
+#include "Utilities.hpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+Assignment encodeAssignment(const vector<vector<uint32_t>>& teams, uint32_t students) {
+    Assignment assignment;
+    assignment.team_of.assign(students, kNoTeam);
+    assignment.team_count = static_cast<uint32_t>(teams.size());
+    for (uint32_t t = 0; t < teams.size(); ++t) {
+        for (uint32_t id : teams[t]) {
+            assignment.team_of[id] = t;
+        }
+    }
+    return assignment;
+}
+
+// LocalSearchOptimizer::objective's terms in the same order, plus the unassigned penalty the
+// optimizer has no use for, since it only sees placed students. Searches that rank layouts with
+// and without unassigned students score all of them here.
+double AssignmentMetrics::objective(const OptimizerOptions& options) const {
+    return options.preference_weight * satisfied_preferences - options.balance_weight * skill_variance -
+           options.minimum_weight * teams_below_minimum - kViolationPenalty * conflict_violations -
+           kUnassignedPenalty * unassigned;
+}
+
+AssignmentEvaluator::AssignmentEvaluator(const Roster& roster) : students(roster.size()), skills(roster.size()) {
+    want_offsets.reserve(size_t(students) + 1);
+    conflict_offsets.reserve(size_t(students) + 1);
+    want_offsets.push_back(0);
+    conflict_offsets.push_back(0);
+    for (uint32_t id = 0; id < students; ++id) {
+        skills[id] = {{roster.skill(0, id), roster.skill(1, id), roster.skill(2, id)}};
+        want_ids.insert(want_ids.end(), roster.wants(id).begin(), roster.wants(id).end());
+        want_offsets.push_back(static_cast<uint32_t>(want_ids.size()));
+        for (uint32_t other : roster.conflicts(id)) {
+            if (other > id) conflict_ids.push_back(other);
+        }
+        conflict_offsets.push_back(static_cast<uint32_t>(conflict_ids.size()));
+    }
+}
+
+AssignmentMetrics AssignmentEvaluator::evaluate(const Assignment& assignment) const {
+    Scratch scratch;
+    return evaluate(assignment, scratch);
+}
+
+AssignmentMetrics AssignmentEvaluator::evaluate(const Assignment& assignment, Scratch& scratch) const {
+    AssignmentMetrics metrics;
+    const vector<uint32_t>& team_of = assignment.team_of;
+    // A layout may hold at most one team per student, which also bounds the scratch buffers
+    if (team_of.size() != students || assignment.team_count > max(students, 1u)) return metrics;
+    uint32_t team_count = assignment.team_count;
+    metrics.teams = team_count;
+    scratch.totals.assign(team_count, {{0, 0, 0}});
+    scratch.sizes.assign(team_count, 0);
+
+    for (uint32_t id = 0; id < students; ++id) {
+        uint32_t team = team_of[id];
+        if (team == kNoTeam) {
+            ++metrics.unassigned;
+            continue;
+        }
+        if (team >= team_count) return AssignmentMetrics();
+        ++scratch.sizes[team];
+        for (int k = 0; k < 3; ++k) {
+            scratch.totals[team][k] += skills[id][k];
+        }
+        for (uint32_t i = want_offsets[id]; i < want_offsets[id + 1]; ++i) {
+            if (team_of[want_ids[i]] == team) ++metrics.satisfied_preferences;
+        }
+        for (uint32_t i = conflict_offsets[id]; i < conflict_offsets[id + 1]; ++i) {
+            if (team_of[conflict_ids[i]] == team) ++metrics.conflict_violations;
+        }
+    }
+
+    array<int, 3> low = {{INT_MAX, INT_MAX, INT_MAX}};
+    array<int, 3> high = {{INT_MIN, INT_MIN, INT_MIN}};
+    array<long long, 3> total_sum = {{0, 0, 0}};
+    array<long long, 3> square_sum = {{0, 0, 0}};
+    for (uint32_t t = 0; t < team_count; ++t) {
+        const array<int, 3>& totals = scratch.totals[t];
+        for (int k = 0; k < 3; ++k) {
+            low[k] = min(low[k], totals[k]);
+            high[k] = max(high[k], totals[k]);
+            total_sum[k] += totals[k];
+            square_sum[k] += static_cast<long long>(totals[k]) * totals[k];
+        }
+        if (missesMinimum(totals, scratch.sizes[t])) {
+            ++metrics.teams_below_minimum;
+        }
+    }
+    if (team_count > 0) {
+        double count = static_cast<double>(team_count);
+        for (int k = 0; k < 3; ++k) {
+            metrics.skill_spread[k] = high[k] - low[k];
+            double mean = total_sum[k] / count;
+            metrics.skill_variance += square_sum[k] / count - mean * mean;
+        }
+    }
+    metrics.valid = true;
+    return metrics;
+}
+
+vector<AssignmentMetrics> AssignmentEvaluator::evaluate(const vector<Assignment>& assignments, unsigned threads) const {
+    vector<AssignmentMetrics> results(assignments.size());
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(min<size_t>(threads, assignments.size()));
+
+    // Layouts are claimed one at a time, so a few large ones cannot leave the other threads idle
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        Scratch scratch;
+        for (size_t i = next.fetch_add(1); i < assignments.size(); i = next.fetch_add(1)) {
+            results[i] = evaluate(assignments[i], scratch);
+        }
+    };
+    vector<thread> pool;
+    for (unsigned w = 1; w < threads; ++w) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool) {
+        t.join();
+    }
+    return results;
+}
+
+bool readAssignment(const string& filename, const Roster& roster, Assignment& assignment, vector<ParseError>& errors) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        errors.push_back({0, "cannot open " + filename});
+        return false;
+    }
+    assignment.team_of.assign(roster.size(), kNoTeam);
+    assignment.team_count = 0;
+
+    string line;
+    string name;
+    size_t line_number = 0;
+    bool with_scores = false;
+    // Place every name in a `separator`-delimited list on `team`
+    auto placeAll = [&](string_view list, char separator, uint32_t team) {
+        while (!list.empty()) {
+            size_t end = list.find(separator);
+            string_view field = trimView(list.substr(0, end));
+            list = end == string_view::npos ? string_view() : list.substr(end + 1);
+            if (field.empty()) continue;
+            name.clear();
+            appendLowerCase(name, field);
+            uint32_t id = roster.find(name);
+            if (id == kNoStudent) {
+                errors.push_back({line_number, "unknown student " + name});
+            } else if (assignment.team_of[id] != kNoTeam) {
+                errors.push_back({line_number, name + " is already on a team"});
+            } else {
+                assignment.team_of[id] = team;
+            }
+        }
+    };
+    while (getline(file, line)) {
+        ++line_number;
+        string_view rest = trimView(line);
+        if (rest.empty()) continue;
+        if (assignment.team_count == 0 && !with_scores) {
+            // Only the two CSV layouts can be read back; say so rather than report every line
+            if (rest[0] == '{' || rest.compare(0, 7, string_view(kTeamsMagic, 7)) == 0) {
+                errors.push_back({line_number, "not a teams CSV; evaluate the csv or scores output format"});
+                return false;
+            }
+            if (rest.compare(0, 16, "team,programming") == 0) {
+                with_scores = true;
+                continue;
+            }
+        }
+        size_t comma = rest.find(',');
+        string_view label = trimView(rest.substr(0, comma));
+        rest = comma == string_view::npos ? string_view() : rest.substr(comma + 1);
+
+        uint32_t team = kNoTeam;
+        if (with_scores) {
+            // "N,programming,debugging,algorithm,total,a;b;c" or "unassigned,,,,,a;b"
+            if (label != "unassigned") {
+                size_t number = 0;
+                if (!parseNumber(string(label), number)) {
+                    errors.push_back({line_number, "expected a team number or unassigned"});
+                    continue;
+                }
+                team = assignment.team_count++;
+            }
+            for (int skipped = 0; skipped < 4 && !rest.empty(); ++skipped) {
+                comma = rest.find(',');
+                rest = comma == string_view::npos ? string_view() : rest.substr(comma + 1);
+            }
+            placeAll(rest, ';', team);
+            continue;
+        }
+        if (label.compare(0, 5, "Team ") == 0) {
+            team = assignment.team_count++;
+        } else if (label != "Unassigned") {
+            errors.push_back({line_number, "expected a Team or Unassigned line"});
+            continue;
+        }
+        placeAll(rest, ',', team);
+    }
+    return true;
+}
+
+void printAssignmentMetrics(const vector<string>& names, const vector<AssignmentMetrics>& metrics) {
+    cout << left << setw(5) << "#" << right << setw(8) << "Teams" << setw(12) << "Unassigned" << setw(11) << "Satisfied"
+         << setw(12) << "Violations" << setw(16) << "Spread P/D/A" << setw(15) << "Below minimum" << "  Layout\n";
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        const AssignmentMetrics& m = metrics[i];
+        cout << left << setw(5) << i + 1 << right;
+        if (!m.valid) {
+            cout << setw(74) << "not a layout of this roster";
+        } else {
+            string spread = to_string(m.skill_spread[0]) + "/" + to_string(m.skill_spread[1]) + "/" +
+                            to_string(m.skill_spread[2]);
+            cout << setw(8) << m.teams << setw(12) << m.unassigned << setw(11) << m.satisfied_preferences << setw(12)
+                 << m.conflict_violations << setw(16) << spread << setw(15) << m.teams_below_minimum;
+        }
+        cout << "  " << names[i] << "\n";
+    }
+    cout << flush;
+}
@@ -0,0 +1,75 @@
+#ifndef EVALUATOR_HPP
+#define EVALUATOR_HPP
+
+#include "Roster.hpp"
+#include "RosterParser.hpp"
+#include "Optimizer.hpp"
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdint>
+
+// A team layout encoded as one team index per student ID, so comparing thousands of
+// layouts costs 4 bytes per student each. kNoTeam leaves a student unassigned.
+struct Assignment {
+    std::vector<uint32_t> team_of;
+    uint32_t team_count = 0;  // Teams are numbered 0..team_count-1; some may be empty
+};
+
+Assignment encodeAssignment(const std::vector<std::vector<uint32_t>>& teams, uint32_t students);
+
+struct AssignmentMetrics {
+    bool valid = false;            // False if team_of has the wrong length or an index past team_count
+    uint32_t teams = 0;
+    uint32_t unassigned = 0;
+    uint32_t satisfied_preferences = 0;  // want_to_work_with entries whose student is on the same team
+    uint32_t conflict_violations = 0;    // Conflicting pairs sharing a team
+    std::array<int, 3> skill_spread = {{0, 0, 0}};  // Highest minus lowest team total, per skill
+    double skill_variance = 0.0;   // Variance of the team totals, summed over the three skills
+    uint32_t teams_below_minimum = 0;  // Teams whose raw scores miss the rubric minimum for their size
+
+    // The optimizer's objective for this layout, with each unassigned student costing kUnassignedPenalty
+    double objective(const OptimizerOptions& options) const;
+};
+
+// Scores layouts against one roster. The skill levels and the want and conflict lists are
+// copied once into flat arrays, so each layout is scored in a single pass over the students.
+// Evaluation only reads the shared data, so one evaluator serves any number of threads.
+class AssignmentEvaluator {
+public:
+    explicit AssignmentEvaluator(const Roster& roster);
+
+    AssignmentMetrics evaluate(const Assignment& assignment) const;
+    // Results are in input order; threads == 0 uses every available core
+    std::vector<AssignmentMetrics> evaluate(const std::vector<Assignment>& assignments, unsigned threads = 0) const;
+
+private:
+    // Per-team accumulators, reused across the layouts one thread evaluates
+    struct Scratch {
+        std::vector<std::array<int, 3>> totals;
+        std::vector<uint32_t> sizes;
+    };
+
+    uint32_t students;
+    std::vector<std::array<uint8_t, 3>> skills;
+    std::vector<uint32_t> want_offsets;
+    std::vector<uint32_t> want_ids;
+    std::vector<uint32_t> conflict_offsets;
+    std::vector<uint32_t> conflict_ids;  // Each pair once, from its lower ID
+
+    AssignmentMetrics evaluate(const Assignment& assignment, Scratch& scratch) const;
+};
+
+// Read a teams CSV as written by writeTeamsToFile, in either CSV layout: plain ("Team N,member,...",
+// then an optional "Unassigned,..." line) or with scores (a header row, then
+// "N,programming,debugging,algorithm,total,a;b;c" and an optional "unassigned,,,,,a;b" row).
+// Students the file never lists are left unassigned. Unknown usernames, repeated students and
+// unrecognised lines are reported in `errors` and skipped; a JSON or binary teams file is
+// rejected with one error and false.
+bool readAssignment(const std::string& filename, const Roster& roster, Assignment& assignment,
+                    std::vector<ParseError>& errors);
+
+// One row per layout: teams, unassigned, satisfied wants, violations, spread and teams below minimum
+void printAssignmentMetrics(const std::vector<std::string>& names, const std::vector<AssignmentMetrics>& metrics);
+
+#endif // EVALUATOR_HPP
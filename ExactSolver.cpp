@@ -0,0 +1,301 @@
+#include "ExactSolver.hpp"
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+// Stored for sets of unplaced students that cannot be split into valid teams at all
+const int kNoCompletion = INT_MIN / 4;
+// Past this many entries the memo stops growing; existing entries are still tightened
+const size_t kMemoLimit = 1 << 20;
+
+namespace {
+
+inline uint64_t bit(uint32_t id) { return uint64_t(1) << id; }
+inline int popcount(uint64_t mask) { return __builtin_popcountll(mask); }
+inline uint32_t lowest(uint64_t mask) { return static_cast<uint32_t>(__builtin_ctzll(mask)); }
+
+// Sum of the `count` highest values among `members`, given masks of students per value, highest first
+int topSum(const vector<pair<int, uint64_t>>& masks, uint64_t members, size_t count) {
+    int sum = 0;
+    for (const auto& level : masks) {
+        if (count == 0) break;
+        size_t take = min<size_t>(popcount(members & level.second), count);
+        sum += static_cast<int>(take) * level.first;
+        count -= take;
+    }
+    return sum;
+}
+
+int maskSum(const vector<pair<int, uint64_t>>& masks, uint64_t members) {
+    int sum = 0;
+    for (const auto& level : masks) {
+        sum += level.first * popcount(members & level.second);
+    }
+    return sum;
+}
+
+void addToLevel(vector<pair<int, uint64_t>>& masks, int level, uint32_t id) {
+    auto it = find_if(masks.begin(), masks.end(), [level](const pair<int, uint64_t>& entry) { return entry.first == level; });
+    if (it == masks.end()) {
+        masks.push_back(make_pair(level, uint64_t(0)));
+        it = masks.end() - 1;
+    }
+    it->second |= bit(id);
+}
+
+} // namespace
+
+ExactSolver::ExactSolver(const Roster& roster, const vector<size_t>& team_targets)
+    : roster(roster), num_students(roster.size()), small_size(0), large_teams(0), small_teams(0),
+      want_mask(num_students, 0), wanted_by_mask(num_students, 0), conflict_mask(num_students, 0),
+      skills(num_students) {
+    if (!team_targets.empty()) {
+        small_size = *min_element(team_targets.begin(), team_targets.end());
+        for (size_t target : team_targets) {
+            (target > small_size ? large_teams : small_teams)++;
+        }
+    }
+    for (uint32_t id = 0; id < num_students; ++id) {
+        for (uint32_t want : roster.wants(id)) {
+            want_mask[id] |= bit(want);
+            wanted_by_mask[want] |= bit(id);
+        }
+        for (uint32_t other : roster.conflicts(id)) {
+            conflict_mask[id] |= bit(other);
+        }
+        for (int k = 0; k < 3; ++k) {
+            skills[id][k] = roster.skill(k, id);
+            addToLevel(level_masks[k], skills[id][k], id);
+        }
+        addToLevel(total_masks, skills[id][0] + skills[id][1] + skills[id][2], id);
+    }
+    auto highest_first = [](const pair<int, uint64_t>& a, const pair<int, uint64_t>& b) { return a.first > b.first; };
+    for (auto& masks : level_masks) {
+        sort(masks.begin(), masks.end(), highest_first);
+    }
+    sort(total_masks.begin(), total_masks.end(), highest_first);
+}
+
+bool ExactSolver::feasible(const vector<uint32_t>& team) const {
+    uint64_t members = 0;
+    array<int, 3> totals = {{0, 0, 0}};
+    for (uint32_t id : team) {
+        if (conflict_mask[id] & members) return false;
+        members |= bit(id);
+        for (int k = 0; k < 3; ++k) totals[k] += skills[id][k];
+    }
+    return meetsMinimum(totals, team.size());
+}
+
+int ExactSolver::satisfiedIn(const vector<uint32_t>& team) const {
+    uint64_t members = 0;
+    for (uint32_t id : team) members |= bit(id);
+    int satisfied = 0;
+    for (uint32_t id : team) satisfied += popcount(want_mask[id] & members);
+    return satisfied;
+}
+
+void ExactSolver::setIncumbent(const vector<vector<uint32_t>>& teams) {
+    uint64_t seen = 0;
+    size_t large = 0, small = 0;
+    int satisfied = 0;
+    for (const auto& team : teams) {
+        if (team.size() == small_size) ++small;
+        else if (team.size() == small_size + 1) ++large;
+        else return;
+        for (uint32_t id : team) {
+            if (id >= num_students || (seen & bit(id))) return;
+            seen |= bit(id);
+        }
+        if (!feasible(team)) return;
+        satisfied += satisfiedIn(team);
+    }
+    if (large != large_teams || small != small_teams || static_cast<uint32_t>(popcount(seen)) != num_students) return;
+    if (satisfied > best) {
+        best = satisfied;
+        best_teams = teams;
+    }
+}
+
+bool ExactSolver::outOfTime() {
+    if (timed_out) return true;
+    if ((++nodes & 1023) == 0 && chrono::steady_clock::now() > deadline) {
+        timed_out = true;
+    }
+    return timed_out;
+}
+
+// Each student can satisfy at most (team size - 1) of their wants, and only towards students
+// still able to join them: the open team's members can only gain from `candidates`, everyone
+// else from the rest of the unplaced students. The sum also covers edges already inside the team.
+int ExactSolver::bound(uint64_t remaining, uint64_t team, uint64_t candidates, size_t team_size) const {
+    int cap = static_cast<int>(small_size + (large_teams > 0 ? 1 : 0)) - 1;
+    int total = 0;
+    for (uint64_t members = team; members; members &= members - 1) {
+        uint32_t id = lowest(members);
+        total += min(popcount(want_mask[id] & (team | candidates)), static_cast<int>(team_size) - 1);
+    }
+    for (uint64_t others = remaining; others; others &= others - 1) {
+        uint32_t id = lowest(others);
+        uint64_t reachable = remaining | ((candidates & bit(id)) ? team : 0);
+        total += min(popcount(want_mask[id] & reachable), cap);
+    }
+    return total;
+}
+
+bool ExactSolver::meetsMinimum(const array<int, 3>& totals, size_t team_size) const {
+    SkillMinimum minimum;
+    if (!skillMinimumFor(team_size, minimum)) return true;
+    return totals[0] >= minimum.per_skill && totals[1] >= minimum.per_skill && totals[2] >= minimum.per_skill &&
+           totals[0] + totals[1] + totals[2] >= minimum.total;
+}
+
+// Whether adding the `needed` best-suited candidates could lift the team to its rubric minimum
+bool ExactSolver::canReachMinimum(const array<int, 3>& totals, uint64_t candidates, size_t team_size, size_t needed) const {
+    SkillMinimum minimum;
+    if (!skillMinimumFor(team_size, minimum)) return true;
+    for (int k = 0; k < 3; ++k) {
+        if (totals[k] + topSum(level_masks[k], candidates, needed) < minimum.per_skill) return false;
+    }
+    return totals[0] + totals[1] + totals[2] + topSum(total_masks, candidates, needed) >= minimum.total;
+}
+
+// Whether the unplaced students hold enough skill, in total, for every team still to be formed
+bool ExactSolver::remainingCanMeetMinimums(uint64_t remaining, size_t large_left, size_t small_left) const {
+    SkillMinimum large, small;
+    int per_skill = 0, total = 0;
+    if (large_left > 0 && skillMinimumFor(small_size + 1, large)) {
+        per_skill += static_cast<int>(large_left) * large.per_skill;
+        total += static_cast<int>(large_left) * large.total;
+    }
+    if (small_left > 0 && skillMinimumFor(small_size, small)) {
+        per_skill += static_cast<int>(small_left) * small.per_skill;
+        total += static_cast<int>(small_left) * small.total;
+    }
+    if (total == 0) return true;
+    for (int k = 0; k < 3; ++k) {
+        if (maskSum(level_masks[k], remaining) < per_skill) return false;
+    }
+    return maskSum(total_masks, remaining) >= total;
+}
+
+// Every unplaced student must be on some team, so any one can anchor the next; taking the one with
+// the most preference edges left puts the decisions that move the objective near the root
+uint32_t ExactSolver::chooseAnchor(uint64_t remaining) const {
+    uint32_t anchor = lowest(remaining);
+    int most = -1;
+    for (uint64_t others = remaining; others; others &= others - 1) {
+        uint32_t id = lowest(others);
+        int edges = popcount((want_mask[id] | wanted_by_mask[id]) & remaining);
+        if (edges > most) {
+            most = edges;
+            anchor = id;
+        }
+    }
+    return anchor;
+}
+
+// Start a new team around an anchor student, trying each size still owed
+void ExactSolver::openTeam(uint64_t remaining, size_t large_left, size_t small_left, int closed_value) {
+    if (remaining == 0) {
+        if (closed_value > best) {
+            best = closed_value;
+            best_teams = current;
+        }
+        return;
+    }
+    if (outOfTime()) return;
+
+    MemoKey key = {remaining, large_left};
+    auto cached = memo.find(key);
+    if (cached != memo.end() && closed_value + cached->second <= best) return;
+    if (closed_value + bound(remaining, 0, 0, 0) <= best) return;
+    if (!remainingCanMeetMinimums(remaining, large_left, small_left)) return;
+
+    uint32_t anchor = chooseAnchor(remaining);
+    uint64_t rest = remaining & ~bit(anchor);
+    if (large_left > 0) {
+        extendTeam(rest, bit(anchor), rest, small_size + 1, large_left - 1, small_left, closed_value, 0, skills[anchor]);
+    }
+    if (small_left > 0 && !timed_out) {
+        extendTeam(rest, bit(anchor), rest, small_size, large_left, small_left - 1, closed_value, 0, skills[anchor]);
+    }
+
+    // Any completion better than the incumbent would have replaced it, so this is an upper bound
+    if (!timed_out) {
+        int value = best < 0 ? kNoCompletion : best - closed_value;
+        if (cached != memo.end()) {
+            cached->second = min(cached->second, value);
+        } else if (memo.size() < kMemoLimit) {
+            memo.emplace(key, value);
+        }
+    }
+}
+
+// Grow the open team from `candidates`. Once a candidate has been tried it is dropped from the
+// candidates of every later branch, so each set of members is built once whatever the order.
+void ExactSolver::extendTeam(uint64_t remaining, uint64_t team, uint64_t candidates, size_t team_size, size_t large_left,
+                             size_t small_left, int closed_value, int team_value, const array<int, 3>& totals) {
+    size_t members = popcount(team);
+    if (members == team_size) {
+        if (!meetsMinimum(totals, team_size)) return;
+        current.emplace_back();
+        for (uint64_t m = team; m; m &= m - 1) {
+            current.back().push_back(lowest(m));
+        }
+        openTeam(remaining, large_left, small_left, closed_value + team_value);
+        current.pop_back();
+        return;
+    }
+    if (outOfTime()) return;
+    size_t needed = team_size - members;
+    if (static_cast<size_t>(popcount(candidates)) < needed) return;
+    if (!canReachMinimum(totals, candidates, team_size, needed)) return;
+    if (closed_value + bound(remaining, team, candidates, team_size) <= best) return;
+
+    // Try the students who bring the most preference edges first, then the strongest
+    vector<pair<int, uint32_t>> order;
+    for (uint64_t m = candidates; m; m &= m - 1) {
+        uint32_t id = lowest(m);
+        if (conflict_mask[id] & team) continue;
+        int gain = popcount(want_mask[id] & team) + popcount(wanted_by_mask[id] & team);
+        order.push_back(make_pair(-(gain * 16 + skills[id][0] + skills[id][1] + skills[id][2]), id));
+    }
+    sort(order.begin(), order.end());
+
+    for (const auto& entry : order) {
+        uint32_t id = entry.second;
+        if (static_cast<size_t>(popcount(candidates)) < needed) break;
+        candidates &= ~bit(id);
+
+        int gain = popcount(want_mask[id] & team) + popcount(wanted_by_mask[id] & team);
+        array<int, 3> next_totals = totals;
+        for (int k = 0; k < 3; ++k) next_totals[k] += skills[id][k];
+        extendTeam(remaining & ~bit(id), team | bit(id), candidates, team_size, large_left, small_left, closed_value,
+                   team_value + gain, next_totals);
+        if (timed_out) return;
+    }
+}
+
+ExactResult ExactSolver::solve(double time_limit_seconds) {
+    deadline = chrono::steady_clock::now() +
+        chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(time_limit_seconds));
+    timed_out = false;
+    nodes = 0;
+    memo.clear();
+    current.clear();
+
+    uint64_t everyone = num_students == 64 ? ~uint64_t(0) : bit(num_students) - 1;
+    int root_bound = bound(everyone, 0, 0, 0);
+    openTeam(everyone, large_teams, small_teams, 0);
+
+    ExactResult result;
+    result.found = best >= 0;
+    result.proven_optimal = !timed_out;
+    result.satisfied = max(best, 0);
+    result.upper_bound = timed_out ? max(root_bound, best) : result.satisfied;
+    result.nodes = nodes;
+    result.teams = best_teams;
+    return result;
+}
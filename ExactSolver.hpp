@@ -0,0 +1,96 @@
+#ifndef EXACTSOLVER_HPP
+#define EXACTSOLVER_HPP
+
+#include "Roster.hpp"
+#include "TeamSize.hpp"
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+// Students are tracked as bits of a 64-bit mask, which caps the exact search
+const uint32_t kExactStudentLimit = 64;
+
+// Exact formation for small sections; on larger rosters the heuristic teams are kept
+struct ExactOptions {
+    bool enabled = false;
+    double time_limit_seconds = 10.0;
+};
+
+struct ExactResult {
+    bool found = false;           // A feasible assignment was found
+    bool proven_optimal = false;  // The search finished, so `satisfied` is the optimum (or none exists)
+    int satisfied = 0;            // want_to_work_with edges inside teams
+    int upper_bound = 0;          // No assignment satisfies more; equals `satisfied` once proven
+    uint64_t nodes = 0;
+    std::vector<std::vector<uint32_t>> teams;
+
+    int gap() const { return upper_bound - satisfied; }
+};
+
+// Branch and bound over set partitions of a small roster: maximises satisfied preferences
+// subject to the conflict lists and the rubric's skill minimums. Teams are built as unordered
+// sets: each is anchored on one unplaced student and every other student is either added or
+// excluded for good, so no set of members is built twice. Partial teams are pruned on an
+// optimistic count of the preference edges still available and on whether the skill minimums
+// can still be reached, and the best completion of every set of unplaced students reached
+// between teams is memoised.
+class ExactSolver {
+public:
+    // Team sizes are taken from `team_targets`; the roster must have at most kExactStudentLimit students
+    ExactSolver(const Roster& roster, const std::vector<size_t>& team_targets);
+
+    // Seed pruning with an assignment found elsewhere; ignored if it breaks a constraint
+    void setIncumbent(const std::vector<std::vector<uint32_t>>& teams);
+    bool feasible(const std::vector<uint32_t>& team) const;
+    int satisfiedIn(const std::vector<uint32_t>& team) const;
+
+    ExactResult solve(double time_limit_seconds);
+
+private:
+    const Roster& roster;
+    uint32_t num_students;
+    size_t small_size;  // Targets differ by at most one: small_size or small_size + 1
+    size_t large_teams;
+    size_t small_teams;
+    std::vector<uint64_t> want_mask;
+    std::vector<uint64_t> wanted_by_mask;
+    std::vector<uint64_t> conflict_mask;
+    std::vector<std::array<int, 3>> skills;
+    // Students at each skill level (per skill) and at each total, highest first
+    std::vector<std::pair<int, uint64_t>> level_masks[3];
+    std::vector<std::pair<int, uint64_t>> total_masks;
+
+    // Upper bound on what the unplaced students can still add, keyed on who is unplaced
+    // and how many of the larger teams are still to be formed
+    struct MemoKey {
+        uint64_t remaining;
+        size_t large_left;
+        bool operator==(const MemoKey& other) const { return remaining == other.remaining && large_left == other.large_left; }
+    };
+    struct MemoKeyHash {
+        size_t operator()(const MemoKey& key) const { return std::hash<uint64_t>()(key.remaining * 31 + key.large_left); }
+    };
+    std::unordered_map<MemoKey, int, MemoKeyHash> memo;
+
+    // Search state
+    std::chrono::steady_clock::time_point deadline;
+    bool timed_out = false;
+    uint64_t nodes = 0;
+    int best = -1;
+    std::vector<std::vector<uint32_t>> best_teams;
+    std::vector<std::vector<uint32_t>> current;
+
+    bool outOfTime();
+    int bound(uint64_t remaining, uint64_t team, uint64_t candidates, size_t team_size) const;
+    bool meetsMinimum(const std::array<int, 3>& totals, size_t team_size) const;
+    bool canReachMinimum(const std::array<int, 3>& totals, uint64_t candidates, size_t team_size, size_t needed) const;
+    bool remainingCanMeetMinimums(uint64_t remaining, size_t large_left, size_t small_left) const;
+    uint32_t chooseAnchor(uint64_t remaining) const;
+    void openTeam(uint64_t remaining, size_t large_left, size_t small_left, int closed_value);
+    void extendTeam(uint64_t remaining, uint64_t team, uint64_t candidates, size_t team_size, size_t large_left,
+                    size_t small_left, int closed_value, int team_value, const std::array<int, 3>& totals);
+};
+
+#endif // EXACTSOLVER_HPP
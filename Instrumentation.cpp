@@ -0,0 +1,98 @@
+#include "Instrumentation.hpp"
+#include <mutex>
+#include <algorithm>
+
+using namespace std;
+
+namespace stats {
+
+namespace {
+
+const char* kPhaseNames[] = {"parse", "map_load", "formation", "optimize", "scoring", "sort", "write"};
+const char* kCounterNames[] = {"repair_rounds", "backtracks", "compatibility_checks", "compatibility_rejects",
+                               "optimizer_moves", "optimizer_accepted", "seeded_teams"};
+const char* kGaugeNames[] = {"peak_team_bytes"};
+
+const size_t kPhases = static_cast<size_t>(Phase::Count);
+const size_t kCounters = static_cast<size_t>(Counter::Count);
+const size_t kGauges = static_cast<size_t>(Gauge::Count);
+
+struct Totals {
+    chrono::steady_clock::duration times[kPhases] = {};
+    uint64_t counters[kCounters] = {};
+    uint64_t gauges[kGauges] = {};
+
+    void merge(const Totals& other) {
+        for (size_t i = 0; i < kPhases; ++i) times[i] += other.times[i];
+        for (size_t i = 0; i < kCounters; ++i) counters[i] += other.counters[i];
+        for (size_t i = 0; i < kGauges; ++i) gauges[i] = max(gauges[i], other.gauges[i]);
+    }
+};
+
+mutex totals_mutex;
+Totals finished;  // Folded in from threads that have exited
+
+// The calling thread's phase times and peaks, plus a copy of its inline counters
+Totals withCounters(const Totals& totals) {
+    Totals result = totals;
+    for (size_t i = 0; i < kCounters; ++i) result.counters[i] += detail::thread_counters.values[i];
+    return result;
+}
+
+struct ThreadTotals : Totals {
+    ~ThreadTotals() {
+        Totals mine = withCounters(*this);
+        lock_guard<mutex> lock(totals_mutex);
+        finished.merge(mine);
+    }
+};
+
+ThreadTotals& local() {
+    thread_local ThreadTotals totals;
+    return totals;
+}
+
+} // namespace
+
+void addTime(Phase phase, chrono::steady_clock::duration elapsed) {
+    local().times[static_cast<size_t>(phase)] += elapsed;
+}
+
+void detail::registerThread() {
+    thread_counters.registered = true;
+    local();
+}
+
+void notePeak(Gauge gauge, uint64_t value) {
+    uint64_t& peak = local().gauges[static_cast<size_t>(gauge)];
+    peak = max(peak, value);
+}
+
+void writeReport(ostream& out) {
+    Totals totals;
+    {
+        lock_guard<mutex> lock(totals_mutex);
+        totals = finished;
+    }
+    totals.merge(withCounters(local()));
+
+    out << "{\"phases_ms\":{";
+    for (size_t i = 0; i < kPhases; ++i) {
+        out << (i == 0 ? "" : ",") << "\"" << kPhaseNames[i]
+            << "\":" << chrono::duration<double, milli>(totals.times[i]).count();
+    }
+    out << "},\"counters\":{";
+    for (size_t i = 0; i < kCounters; ++i) {
+        out << (i == 0 ? "" : ",") << "\"" << kCounterNames[i] << "\":" << totals.counters[i];
+    }
+    uint64_t checks = totals.counters[static_cast<size_t>(Counter::CompatibilityChecks)];
+    uint64_t rejects = totals.counters[static_cast<size_t>(Counter::CompatibilityRejects)];
+    out << ",\"compatibility_reject_rate\":" << (checks == 0 ? 0.0 : static_cast<double>(rejects) / checks);
+    out << "},\"gauges\":{";
+    for (size_t i = 0; i < kGauges; ++i) {
+        out << (i == 0 ? "" : ",") << "\"" << kGaugeNames[i] << "\":" << totals.gauges[i];
+    }
+    out << "}}\n";
+}
+
+} // namespace stats
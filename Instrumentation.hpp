@@ -0,0 +1,85 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <ostream>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+// Lightweight run statistics: per-phase wall time, event counters and peak gauges.
+// Each thread accumulates into its own thread-local block, which is folded into the
+// process totals when the thread exits, so hot paths never touch shared memory.
+// Building with -DTEAMBUILDER_NO_STATS compiles every STATS_* macro out.
+namespace stats {
+
+enum class Phase { Parse, MapLoad, Formation, Optimize, Scoring, Sort, Write, Count };
+
+enum class Counter {
+    RepairRounds,         // Times the backtracking repair released a set of teams
+    Backtracks,
+    CompatibilityChecks,  // canWorkTogether calls
+    CompatibilityRejects, // ... that found a conflict
+    OptimizerMoves,
+    OptimizerAccepted,
+    SeededTeams,          // Teams started from a mutual-preference clique
+    Count
+};
+
+enum class Gauge { TeamBytes, Count };
+
+void addTime(Phase phase, std::chrono::steady_clock::duration elapsed);
+void notePeak(Gauge gauge, uint64_t value);
+
+namespace detail {
+
+// Counters sit on hot paths such as canWorkTogether, so they live in a trivially
+// constructed thread-local that inlines to a plain increment. The first count on a
+// thread registers it so its counters are folded into the totals when it exits.
+struct ThreadCounters {
+    bool registered;
+    uint64_t values[static_cast<size_t>(Counter::Count)];
+};
+
+inline thread_local ThreadCounters thread_counters = {};
+
+void registerThread();
+
+} // namespace detail
+
+inline void add(Counter counter, uint64_t amount = 1) {
+    detail::ThreadCounters& counters = detail::thread_counters;
+    if (!counters.registered) detail::registerThread();
+    counters.values[static_cast<size_t>(counter)] += amount;
+}
+
+// Totals over all finished threads plus the calling one, as a JSON object
+void writeReport(std::ostream& out);
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { addTime(phase, std::chrono::steady_clock::now() - start); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // namespace stats
+
+#define STATS_CONCAT_INNER(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_INNER(a, b)
+
+#ifdef TEAMBUILDER_NO_STATS
+#define STATS_TIMER(phase) do {} while (0)
+#define STATS_COUNT(counter, amount) do {} while (0)
+#define STATS_PEAK(gauge, value) do {} while (0)
+#else
+#define STATS_TIMER(phase) stats::ScopedTimer STATS_CONCAT(stats_timer_, __LINE__)(stats::Phase::phase)
+#define STATS_COUNT(counter, amount) stats::add(stats::Counter::counter, (amount))
+#define STATS_PEAK(gauge, value) stats::notePeak(stats::Gauge::gauge, (value))
+#endif
+
+#endif // INSTRUMENTATION_HPP
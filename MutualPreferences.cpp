@@ -0,0 +1,81 @@
+#include "MutualPreferences.hpp"
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+namespace {
+
+bool lists(Span<uint32_t> wants, uint32_t id) {
+    return find(wants.begin(), wants.end(), id) != wants.end();
+}
+
+} // namespace
+
+vector<vector<uint32_t>> mutualPreferenceCliques(const Roster& roster, const CandidatePool& pool, size_t max_size) {
+    vector<vector<uint32_t>> cliques;
+    if (max_size < 2) return cliques;
+
+    // Index the reciprocal pairs among pool students, one partner list per student that has any,
+    // kept in pool order
+    vector<uint32_t> members;
+    vector<uint32_t> offsets(1, 0);
+    vector<uint32_t> partners;
+    for (uint32_t id = pool.frontWithPreferences(); id != kNoStudent; id = pool.nextWithPreferences(id)) {
+        for (uint32_t other : roster.wants(id)) {
+            if (pool.contains(other) && lists(roster.wants(other), id) && !roster.hasConflict(id, other)) {
+                partners.push_back(other);
+            }
+        }
+        if (partners.size() > offsets.back()) {
+            members.push_back(id);
+            offsets.push_back(static_cast<uint32_t>(partners.size()));
+        }
+    }
+    if (members.empty()) return cliques;
+
+    // Partner lists hold local indices from here on, so membership and degree are array lookups
+    vector<uint32_t> local(pool.orderSize(), kNoStudent);
+    for (uint32_t i = 0; i < members.size(); ++i) {
+        local[pool.indexOf(members[i])] = i;
+    }
+    for (uint32_t& other : partners) {
+        other = local[pool.indexOf(other)];
+    }
+    auto degree = [&](uint32_t i) { return offsets[i + 1] - offsets[i]; };
+    auto reciprocal = [&](uint32_t a, uint32_t b) {
+        return find(partners.begin() + offsets[a], partners.begin() + offsets[a + 1], b) != partners.begin() + offsets[a + 1];
+    };
+
+    vector<uint32_t> seeds(members.size());
+    iota(seeds.begin(), seeds.end(), 0);
+    stable_sort(seeds.begin(), seeds.end(), [&](uint32_t a, uint32_t b) { return degree(a) > degree(b); });
+
+    vector<char> taken(members.size(), 0);
+    vector<uint32_t> clique, candidates;
+    for (uint32_t seed : seeds) {
+        if (taken[seed]) continue;
+        clique.assign(1, seed);
+        candidates.clear();
+        for (uint32_t k = offsets[seed]; k < offsets[seed + 1]; ++k) {
+            if (!taken[partners[k]]) candidates.push_back(partners[k]);
+        }
+        stable_sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) { return degree(a) > degree(b); });
+        for (uint32_t candidate : candidates) {
+            if (clique.size() == max_size) break;
+            bool with_all = all_of(clique.begin() + 1, clique.end(), [&](uint32_t member) { return reciprocal(candidate, member); });
+            if (with_all) clique.push_back(candidate);
+        }
+        if (clique.size() < 2) continue;
+
+        cliques.emplace_back();
+        for (uint32_t i : clique) {
+            taken[i] = 1;
+            cliques.back().push_back(members[i]);
+        }
+    }
+    stable_sort(cliques.begin(), cliques.end(), [](const vector<uint32_t>& a, const vector<uint32_t>& b) {
+        return a.size() > b.size();
+    });
+    return cliques;
+}
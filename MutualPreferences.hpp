@@ -0,0 +1,17 @@
+#ifndef MUTUALPREFERENCES_HPP
+#define MUTUALPREFERENCES_HPP
+
+#include "Roster.hpp"
+#include "CandidatePool.hpp"
+#include <vector>
+#include <cstdint>
+
+// Groups of pool students who all listed each other as want_to_work_with and have no
+// conflicts among them, each of 2 to `max_size` students, largest first. Students with the
+// most reciprocal pairs seed first, and each group is grown from its seed's partners until no
+// remaining partner is reciprocal with every member, so a group is a maximal clique of the
+// reciprocal-pair graph among the students not already grouped.
+std::vector<std::vector<uint32_t>> mutualPreferenceCliques(const Roster& roster, const CandidatePool& pool,
+                                                           size_t max_size);
+
+#endif // MUTUALPREFERENCES_HPP
@@ -0,0 +1,278 @@
+#include "Optimizer.hpp"
+#include "Instrumentation.hpp"
+#include "TeamSize.hpp"
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+LocalSearchOptimizer::LocalSearchOptimizer(const Roster& roster, const OptimizerOptions& options)
+    : roster(roster), options(options) {
+    skills.resize(roster.size());
+    for (uint32_t id = 0; id < roster.size(); ++id) {
+        const Student& s = roster.student(id);
+        skills[id] = {{s.programming_skill, s.debugging_skill, s.algorithm_skill}};
+    }
+}
+
+// Build the membership index, team totals and objective terms for a starting assignment
+void LocalSearchOptimizer::load(vector<vector<uint32_t>>& teams) {
+    this->teams = &teams;
+    team_of.assign(roster.size(), kNoTeam);
+    slot_of.assign(roster.size(), 0);
+    totals.assign(teams.size(), {{0, 0, 0}});
+    total_sum = {{0, 0, 0}};
+    square_sum = {{0, 0, 0}};
+    min_size = teams.empty() ? 0 : SIZE_MAX;
+    max_size = 0;
+    below_minimum = 0;
+
+    for (uint32_t t = 0; t < teams.size(); ++t) {
+        min_size = min(min_size, teams[t].size());
+        max_size = max(max_size, teams[t].size());
+        for (uint32_t slot = 0; slot < teams[t].size(); ++slot) {
+            uint32_t id = teams[t][slot];
+            team_of[id] = t;
+            slot_of[id] = slot;
+        }
+        totals[t] = roster.skillTotals(teams[t].data(), teams[t].size());
+        below_minimum += missesMinimum(totals[t], teams[t].size()) ? 1 : 0;
+        for (int k = 0; k < 3; ++k) {
+            total_sum[k] += totals[t][k];
+            square_sum[k] += static_cast<long long>(totals[t][k]) * totals[t][k];
+        }
+    }
+
+    satisfied = 0;
+    violations = 0;
+    for (uint32_t id = 0; id < roster.size(); ++id) {
+        if (team_of[id] == kNoTeam) continue;
+        for (uint32_t want : roster.wants(id)) {
+            if (team_of[want] == team_of[id]) ++satisfied;
+        }
+        for (uint32_t other : roster.conflicts(id)) {
+            if (other > id && team_of[other] == team_of[id]) ++violations;
+        }
+    }
+}
+
+// Preference edges, in either direction, between a student and the members of a team
+int LocalSearchOptimizer::links(uint32_t id, uint32_t team) const {
+    int count = 0;
+    for (uint32_t want : roster.wants(id)) {
+        if (team_of[want] == team) ++count;
+    }
+    for (uint32_t fan : roster.wantedBy(id)) {
+        if (team_of[fan] == team) ++count;
+    }
+    return count;
+}
+
+int LocalSearchOptimizer::conflictsIn(uint32_t id, uint32_t team) const {
+    int count = 0;
+    for (uint32_t other : roster.conflicts(id)) {
+        if (team_of[other] == team) ++count;
+    }
+    return count;
+}
+
+int LocalSearchOptimizer::mutualLinks(uint32_t a, uint32_t b) const {
+    Span<uint32_t> wants_a = roster.wants(a);
+    Span<uint32_t> wants_b = roster.wants(b);
+    return static_cast<int>(count(wants_a.begin(), wants_a.end(), b) + count(wants_b.begin(), wants_b.end(), a));
+}
+
+// Change in summed variance when `shift` skill points move from team_a to team_b.
+// Only the two teams' squares change; the grand totals (and so the means) do not.
+double LocalSearchOptimizer::balanceDelta(uint32_t team_a, uint32_t team_b, const array<int, 3>& shift) const {
+    long long delta = 0;
+    for (int k = 0; k < 3; ++k) {
+        long long d = shift[k];
+        delta += 2 * d * (totals[team_b][k] - totals[team_a][k] + d);
+    }
+    return static_cast<double>(delta) / totals.size();
+}
+
+void LocalSearchOptimizer::applyShift(uint32_t team_a, uint32_t team_b, const array<int, 3>& shift) {
+    for (int k = 0; k < 3; ++k) {
+        square_sum[k] -= static_cast<long long>(totals[team_a][k]) * totals[team_a][k] +
+                         static_cast<long long>(totals[team_b][k]) * totals[team_b][k];
+        totals[team_a][k] -= shift[k];
+        totals[team_b][k] += shift[k];
+        square_sum[k] += static_cast<long long>(totals[team_a][k]) * totals[team_a][k] +
+                         static_cast<long long>(totals[team_b][k]) * totals[team_b][k];
+    }
+}
+
+// Move a student to the end of another team's member list, swap-removing them from their old team
+void LocalSearchOptimizer::relocate(uint32_t id, uint32_t team) {
+    vector<uint32_t>& from = (*teams)[team_of[id]];
+    uint32_t last = from.back();
+    from[slot_of[id]] = last;
+    slot_of[last] = slot_of[id];
+    from.pop_back();
+
+    vector<uint32_t>& to = (*teams)[team];
+    slot_of[id] = static_cast<uint32_t>(to.size());
+    to.push_back(id);
+    team_of[id] = team;
+}
+
+double LocalSearchOptimizer::skillVariance() const {
+    if (totals.empty()) return 0.0;
+    double variance = 0.0;
+    double count = static_cast<double>(totals.size());
+    for (int k = 0; k < 3; ++k) {
+        double mean = total_sum[k] / count;
+        variance += square_sum[k] / count - mean * mean;
+    }
+    return variance;
+}
+
+double LocalSearchOptimizer::objective() const {
+    return options.preference_weight * satisfied - options.balance_weight * skillVariance() -
+           options.minimum_weight * below_minimum - kViolationPenalty * violations;
+}
+
+double LocalSearchOptimizer::evaluate(vector<vector<uint32_t>>& teams) {
+    load(teams);
+    return objective();
+}
+
+double LocalSearchOptimizer::optimize(vector<vector<uint32_t>>& teams) {
+    load(teams);
+    uint32_t num_teams = static_cast<uint32_t>(teams.size());
+    iterations_run = 0;
+
+    vector<uint32_t> members;
+    for (uint32_t id = 0; id < roster.size(); ++id) {
+        if (team_of[id] != kNoTeam) members.push_back(id);
+    }
+    if (num_teams < 2 || members.size() < 2 || options.iterations == 0) {
+        return objective();
+    }
+
+    Random random(options.seed);
+    // A zero (or negative) temperature would make the cooling ratio divide by zero, so both ends
+    // are clamped to a tiny positive floor, where only improving moves are ever taken
+    double initial_temperature = max(options.initial_temperature, kMinTemperature);
+    double final_temperature = min(max(options.final_temperature, kMinTemperature), initial_temperature);
+    double temperature = initial_temperature;
+    double cooling = pow(final_temperature / initial_temperature, 1.0 / options.iterations);
+
+    // The best assignment is the current one with the moves since it undone. Those moves are logged as
+    // (student, team before the move); once the log outgrows the roster, the best is copied out instead.
+    double best = objective();
+    vector<pair<uint32_t, uint32_t>> since_best;
+    vector<uint32_t> best_team_of;
+    bool best_copied = false;
+    auto undoSinceBest = [&since_best](vector<uint32_t>& assignment) {
+        for (auto it = since_best.rbegin(); it != since_best.rend(); ++it) {
+            assignment[it->first] = it->second;
+        }
+        since_best.clear();
+    };
+    uint64_t accepted = 0;
+
+    uint64_t iteration = 0;
+    for (; iteration < options.iterations; ++iteration, temperature *= cooling) {
+        if ((iteration & 1023) == 0 && stop_check && stop_check()) break;
+
+        uint32_t s = members[random.below(static_cast<uint32_t>(members.size()))];
+        uint32_t team_a = team_of[s];
+        uint32_t team_b = random.below(num_teams - 1);
+        if (team_b >= team_a) ++team_b;
+
+        bool can_move = teams[team_a].size() > min_size && teams[team_b].size() < max_size;
+        bool do_swap = !teams[team_b].empty() && (!can_move || (random.next() & 1));
+        if (!do_swap && !can_move) continue;
+
+        uint32_t u = kNoStudent;
+        int preference_delta;
+        int violation_delta;
+        array<int, 3> shift = skills[s];
+        if (do_swap) {
+            u = teams[team_b][random.below(static_cast<uint32_t>(teams[team_b].size()))];
+            int pair_conflict = roster.hasConflict(s, u) ? 1 : 0;
+            violation_delta = (conflictsIn(s, team_b) - pair_conflict) + (conflictsIn(u, team_a) - pair_conflict) -
+                              conflictsIn(s, team_a) - conflictsIn(u, team_b);
+            if (violation_delta > 0) continue;
+            int pair_links = mutualLinks(s, u);
+            preference_delta = (links(s, team_b) - pair_links) - links(s, team_a) +
+                               (links(u, team_a) - pair_links) - links(u, team_b);
+            for (int k = 0; k < 3; ++k) {
+                shift[k] -= skills[u][k];
+            }
+        } else {
+            violation_delta = conflictsIn(s, team_b) - conflictsIn(s, team_a);
+            if (violation_delta > 0) continue;
+            preference_delta = links(s, team_b) - links(s, team_a);
+        }
+
+        // Only the two teams' compliance can change; a move also changes their sizes
+        size_t size_a = teams[team_a].size() - (do_swap ? 0 : 1);
+        size_t size_b = teams[team_b].size() + (do_swap ? 0 : 1);
+        array<int, 3> after_a = totals[team_a];
+        array<int, 3> after_b = totals[team_b];
+        for (int k = 0; k < 3; ++k) {
+            after_a[k] -= shift[k];
+            after_b[k] += shift[k];
+        }
+        int minimum_delta = int(missesMinimum(after_a, size_a)) + int(missesMinimum(after_b, size_b)) -
+                            int(missesMinimum(totals[team_a], teams[team_a].size())) -
+                            int(missesMinimum(totals[team_b], teams[team_b].size()));
+
+        double delta = options.preference_weight * preference_delta -
+                       options.balance_weight * balanceDelta(team_a, team_b, shift) -
+                       options.minimum_weight * minimum_delta - kViolationPenalty * violation_delta;
+        if (delta < 0 && random.unit() >= exp(delta / temperature)) continue;
+
+        if (!best_copied) {
+            since_best.push_back(make_pair(s, team_a));
+            if (do_swap) since_best.push_back(make_pair(u, team_b));
+        }
+        if (do_swap) {
+            teams[team_a][slot_of[s]] = u;
+            teams[team_b][slot_of[u]] = s;
+            swap(slot_of[s], slot_of[u]);
+            team_of[s] = team_b;
+            team_of[u] = team_a;
+        } else {
+            relocate(s, team_b);
+        }
+        applyShift(team_a, team_b, shift);
+        satisfied += preference_delta;
+        violations += violation_delta;
+        below_minimum += minimum_delta;
+        ++accepted;
+
+        if (objective() > best) {
+            best = objective();
+            since_best.clear();
+            best_copied = false;
+        } else if (!best_copied && since_best.size() > members.size()) {
+            best_team_of = team_of;
+            undoSinceBest(best_team_of);
+            best_copied = true;
+        }
+    }
+    iterations_run = iteration;
+    STATS_COUNT(OptimizerMoves, iteration);
+    STATS_COUNT(OptimizerAccepted, accepted);
+
+    // Fall back to the best assignment if the walk ended somewhere worse
+    if (best_copied || !since_best.empty()) {
+        if (!best_copied) {
+            best_team_of = team_of;
+            undoSinceBest(best_team_of);
+        }
+        for (auto& team : teams) {
+            team.clear();
+        }
+        for (uint32_t id : members) {
+            teams[best_team_of[id]].push_back(id);
+        }
+        load(teams);
+    }
+    return objective();
+}
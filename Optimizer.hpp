@@ -0,0 +1,104 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "Roster.hpp"
+#include <vector>
+#include <array>
+#include <functional>
+#include <cstdint>
+
+const uint32_t kNoTeam = UINT32_MAX;
+
+// Moves that would put two conflicting students together are rejected outright;
+// the penalty only matters if the starting assignment already has violations.
+const double kViolationPenalty = 1e6;
+
+// Every student left unassigned outweighs any achievable objective when comparing assignments
+const double kUnassignedPenalty = 1e9;
+
+// Annealing temperatures below this are raised to it, so the cooling schedule never divides by zero
+const double kMinTemperature = 1e-9;
+
+// Small deterministic generator so seeded runs reproduce on every platform
+class Random {
+public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    // splitmix64
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    uint32_t below(uint32_t bound) { return static_cast<uint32_t>((next() >> 32) * bound >> 32); }
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    uint64_t state;
+};
+
+struct OptimizerOptions {
+    bool enabled = false;
+    uint64_t iterations = 200000;
+    uint64_t seed = 1;
+    double preference_weight = 1.0;   // Per satisfied want_to_work_with edge
+    double balance_weight = 1.0;      // Per unit of skill-total variance, summed over the three skills
+    double minimum_weight = 0.0;      // Per team whose raw totals miss the rubric minimum for its size
+    double initial_temperature = 2.0;
+    double final_temperature = 0.01;
+};
+
+// Simulated annealing over pairwise swaps and single moves between teams.
+// Each move is scored incrementally from the moved students' adjacency and
+// the two affected team totals, so no full re-scoring is needed.
+class LocalSearchOptimizer {
+public:
+    LocalSearchOptimizer(const Roster& roster, const OptimizerOptions& options);
+    // New weights or schedule for the next run; the per-student tables built from the roster are kept
+    void setOptions(const OptimizerOptions& new_options) { options = new_options; }
+
+    // Improves the teams in place and returns the final objective. Team sizes
+    // stay within the smallest and largest sizes of the input.
+    double optimize(std::vector<std::vector<uint32_t>>& teams);
+    // Scores an assignment without changing it
+    double evaluate(std::vector<std::vector<uint32_t>>& teams);
+    // Polled every 1024 iterations; once it returns true, optimize() keeps the best assignment so far
+    void setStopCheck(std::function<bool()> check) { stop_check = std::move(check); }
+    uint64_t iterationsRun() const { return iterations_run; }
+
+    double objective() const;
+    int satisfiedPreferences() const { return satisfied; }
+    int conflictViolations() const { return violations; }
+    int teamsBelowMinimum() const { return below_minimum; }
+    double skillVariance() const;
+
+private:
+    const Roster& roster;
+    OptimizerOptions options;
+    std::function<bool()> stop_check;
+    uint64_t iterations_run = 0;
+    std::vector<std::array<int, 3>> skills;
+
+    std::vector<std::vector<uint32_t>>* teams = nullptr;
+    std::vector<uint32_t> team_of;
+    std::vector<uint32_t> slot_of;  // Position of each student inside their team's member list
+    std::vector<std::array<int, 3>> totals;
+    std::array<long long, 3> total_sum;
+    std::array<long long, 3> square_sum;
+    int satisfied = 0;
+    int violations = 0;
+    int below_minimum = 0;
+    size_t min_size = 0;
+    size_t max_size = 0;
+
+    void load(std::vector<std::vector<uint32_t>>& teams);
+    int links(uint32_t id, uint32_t team) const;
+    int conflictsIn(uint32_t id, uint32_t team) const;
+    int mutualLinks(uint32_t a, uint32_t b) const;
+    double balanceDelta(uint32_t team_a, uint32_t team_b, const std::array<int, 3>& shift) const;
+    void applyShift(uint32_t team_a, uint32_t team_b, const std::array<int, 3>& shift);
+    void relocate(uint32_t id, uint32_t team);
+};
+
+#endif // OPTIMIZER_HPP
@@ -0,0 +1,135 @@
+#include "Pareto.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+bool parseObjectiveWeights(const string& text, ObjectiveWeights& weights) {
+    double values[3] = {0.0, 0.0, 0.0};
+    size_t count = 0;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = min(text.find(',', start), text.size());
+        if (count == 3) return false;
+        string field = text.substr(start, comma - start);
+        char* end = nullptr;
+        values[count] = strtod(field.c_str(), &end);
+        if (field.empty() || *end != '\0' || !(values[count] >= 0.0) || std::isinf(values[count])) return false;
+        ++count;
+        start = comma + 1;
+    }
+    if (count < 2 || values[0] + values[1] + values[2] == 0.0) return false;
+    weights.preference = values[0];
+    weights.balance = values[1];
+    weights.minimum = values[2];
+    return true;
+}
+
+void applyWeights(const ObjectiveWeights& weights, OptimizerOptions& options) {
+    options.preference_weight = weights.preference;
+    options.balance_weight = weights.balance;
+    options.minimum_weight = weights.minimum;
+}
+
+vector<ObjectiveWeights> simplexWeights(size_t steps) {
+    vector<ObjectiveWeights> weights;
+    steps = max<size_t>(steps, 1);
+    // Rows step the preference weight down; each row snakes back along the one before it
+    for (size_t row = 0; row <= steps; ++row) {
+        for (size_t k = 0; k <= row; ++k) {
+            size_t balance = row % 2 == 0 ? k : row - k;
+            ObjectiveWeights w;
+            w.preference = double(steps - row) / steps;
+            w.balance = double(balance) / steps;
+            w.minimum = double(row - balance) / steps;
+            weights.push_back(w);
+        }
+    }
+    return weights;
+}
+
+size_t markParetoFront(vector<ParetoPoint>& points) {
+    auto dominates = [](const AssignmentMetrics& a, const AssignmentMetrics& b) {
+        bool no_worse = a.satisfied_preferences >= b.satisfied_preferences && a.skill_variance <= b.skill_variance &&
+                        a.teams_below_minimum <= b.teams_below_minimum;
+        bool better = a.satisfied_preferences > b.satisfied_preferences || a.skill_variance < b.skill_variance ||
+                      a.teams_below_minimum < b.teams_below_minimum;
+        return no_worse && better;
+    };
+    auto same = [](const AssignmentMetrics& a, const AssignmentMetrics& b) {
+        return a.satisfied_preferences == b.satisfied_preferences && a.skill_variance == b.skill_variance &&
+               a.teams_below_minimum == b.teams_below_minimum;
+    };
+    size_t on_front = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        points[i].on_front = true;
+        for (size_t j = 0; j < points.size() && points[i].on_front; ++j) {
+            if (dominates(points[j].metrics, points[i].metrics) || (j < i && same(points[j].metrics, points[i].metrics))) {
+                points[i].on_front = false;
+            }
+        }
+        if (points[i].on_front) ++on_front;
+    }
+    return on_front;
+}
+
+ParetoSweep::ParetoSweep(shared_ptr<const Roster> roster, int team_size, bool prioritize_skills)
+    : roster(roster), team_size(team_size), prioritize_skills(prioritize_skills) {
+}
+
+ParetoSweepResult ParetoSweep::run(const vector<ObjectiveWeights>& weights, bool prioritize_preferences) {
+    ParetoSweepResult result;
+    TeamBuilder builder(roster, team_size, prioritize_skills);
+    builder.setVerbose(false);
+    builder.setSolverBudget(solver_budget);
+    result.status = builder.formTeams(prioritize_preferences);
+    if (result.status == FormationStatus::Infeasible) {
+        return result;
+    }
+    result.unassigned = builder.unassignedStudents();
+    vector<vector<uint32_t>> teams = builder.teamMembers();
+
+    AssignmentEvaluator evaluator(*roster);
+    LocalSearchOptimizer optimizer(*roster, optimizer_options);
+    for (size_t i = 0; i < weights.size(); ++i) {
+        OptimizerOptions options = optimizer_options;
+        applyWeights(weights[i], options);
+        options.seed = optimizer_options.seed + i;
+        if (i > 0) {
+            options.initial_temperature = sqrt(options.initial_temperature * options.final_temperature);
+            options.iterations = max<uint64_t>(1, options.iterations / 2);
+        }
+        optimizer.setOptions(options);
+        optimizer.optimize(teams);
+
+        ParetoPoint point;
+        point.weights = weights[i];
+        point.iterations = optimizer.iterationsRun();
+        point.teams = teams;
+        point.metrics = evaluator.evaluate(encodeAssignment(teams, roster->size()));
+        point.objective = point.metrics.objective(options);
+        result.points.push_back(move(point));
+    }
+    markParetoFront(result.points);
+    return result;
+}
+
+void printParetoPoints(const vector<ParetoPoint>& points) {
+    cout << left << setw(5) << "#" << right << setw(18) << "Weights P/B/M" << setw(11) << "Satisfied" << setw(12)
+         << "Variance" << setw(15) << "Below minimum" << setw(14) << "Objective" << "  Front\n";
+    for (size_t i = 0; i < points.size(); ++i) {
+        const ParetoPoint& p = points[i];
+        ostringstream weights;
+        weights << fixed << setprecision(2) << p.weights.preference << "/" << p.weights.balance << "/"
+                << p.weights.minimum;
+        cout << left << setw(5) << i + 1 << right << setw(18) << weights.str() << setw(11)
+             << p.metrics.satisfied_preferences << fixed << setprecision(3) << setw(12) << p.metrics.skill_variance
+             << setw(15) << p.metrics.teams_below_minimum << setw(14) << p.objective << "  "
+             << (p.on_front ? "*" : "") << "\n";
+    }
+    cout << defaultfloat << flush;
+}
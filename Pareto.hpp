@@ -0,0 +1,72 @@
+#ifndef PARETO_HPP
+#define PARETO_HPP
+
+#include "TeamBuilder.hpp"
+#include "Evaluator.hpp"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// Weights of the three objective terms; see OptimizerOptions for their units
+struct ObjectiveWeights {
+    double preference = 1.0;
+    double balance = 1.0;
+    double minimum = 0.0;
+};
+
+// Parse "P,B,M", e.g. "1,0.5,10"; a missing minimum weight is 0. Weights must be non-negative
+// and not all zero.
+bool parseObjectiveWeights(const std::string& text, ObjectiveWeights& weights);
+void applyWeights(const ObjectiveWeights& weights, OptimizerOptions& options);
+
+// Every weighting with preference + balance + minimum = 1 in steps of 1/steps, in an order where
+// consecutive settings differ by one step in two of the weights, so each is a short warm start
+// from the one before
+std::vector<ObjectiveWeights> simplexWeights(size_t steps);
+
+struct ParetoPoint {
+    ObjectiveWeights weights;
+    AssignmentMetrics metrics;
+    double objective = 0.0;    // Under this point's own weights
+    uint64_t iterations = 0;   // Optimizer moves tried for this point
+    bool on_front = false;
+    std::vector<std::vector<uint32_t>> teams;
+};
+
+struct ParetoSweepResult {
+    FormationStatus status = FormationStatus::Infeasible;
+    std::vector<uint32_t> unassigned;  // The same for every point; annealing never places anyone
+    std::vector<ParetoPoint> points;   // In sweep order
+};
+
+// A point is on the front unless another is at least as good on satisfied preferences, skill
+// variance and teams below minimum, and better on one of them. Of points that tie on all three,
+// only the first is on the front. Returns the number on the front.
+size_t markParetoFront(std::vector<ParetoPoint>& points);
+
+// One formation, then one annealing run per weight setting. The roster, the evaluator and the
+// optimizer's per-student tables are built once, and each run starts from the teams the previous
+// run left. Warm runs skip the hot first half of the cooling schedule: they start at its
+// geometric midpoint and run half the iterations, so they refine rather than scramble.
+class ParetoSweep {
+public:
+    ParetoSweep(std::shared_ptr<const Roster> roster, int team_size, bool prioritize_skills);
+    void setSolverBudget(const SolverBudget& budget) { solver_budget = budget; }
+    // Iterations, seed and temperatures of the first run; the weights come from the sweep
+    void setOptimizerOptions(const OptimizerOptions& options) { optimizer_options = options; }
+
+    ParetoSweepResult run(const std::vector<ObjectiveWeights>& weights, bool prioritize_preferences);
+
+private:
+    std::shared_ptr<const Roster> roster;
+    int team_size;
+    bool prioritize_skills;
+    SolverBudget solver_budget;
+    OptimizerOptions optimizer_options;
+};
+
+// One row per point: weights, satisfied wants, variance, teams below minimum, objective, front mark
+void printParetoPoints(const std::vector<ParetoPoint>& points);
+
+#endif // PARETO_HPP
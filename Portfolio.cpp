@@ -0,0 +1,89 @@
+#include "Portfolio.hpp"
+#include "Evaluator.hpp"
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+using namespace std;
+
+PortfolioSearch::PortfolioSearch(shared_ptr<const Roster> roster, int team_size, bool prioritize_skills)
+    : roster(roster), team_size(team_size), prioritize_skills(prioritize_skills) {
+}
+
+PortfolioResult PortfolioSearch::run(const vector<uint64_t>& seeds, bool prioritize_preferences, unsigned threads) {
+    PortfolioResult best_result;
+    if (seeds.empty()) {
+        return best_result;
+    }
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    threads = min<unsigned>(threads, static_cast<unsigned>(seeds.size()));
+
+    // scores[i] is written once by whichever worker ran seeds[i], before it tries to publish i
+    vector<double> scores(seeds.size(), 0.0);
+    AssignmentEvaluator evaluator(*roster);
+    const uint32_t kNone = UINT32_MAX;
+    atomic<uint32_t> best_index(kNone);
+    atomic<size_t> next_seed(0);
+
+    auto better = [&](uint32_t a, uint32_t b) {
+        return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+    };
+
+    // Each worker keeps only the assignments that beat the shared best at the time they finished
+    vector<PortfolioResult> worker_best(threads);
+    vector<uint32_t> worker_index(threads, kNone);
+
+    auto worker = [&](unsigned w) {
+        for (size_t i = next_seed.fetch_add(1); i < seeds.size(); i = next_seed.fetch_add(1)) {
+            TeamBuilder builder(roster, team_size, prioritize_skills);
+            builder.setVerbose(false);
+            builder.setSolverBudget(solver_budget);
+            OptimizerOptions options = optimizer_options;
+            options.seed = seeds[i];
+            builder.setOptimizerOptions(options);
+            builder.setFormationSeed(seeds[i]);
+            FormationStatus status = builder.formTeams(prioritize_preferences);
+
+            vector<vector<uint32_t>> teams = builder.teamMembers();
+            scores[i] = evaluator.evaluate(encodeAssignment(teams, roster->size())).objective(options);
+
+            uint32_t index = static_cast<uint32_t>(i);
+            uint32_t current = best_index.load(memory_order_acquire);
+            bool published = false;
+            while (current == kNone || better(index, current)) {
+                if (best_index.compare_exchange_weak(current, index, memory_order_acq_rel, memory_order_acquire)) {
+                    published = true;
+                    break;
+                }
+            }
+            if (published) {
+                worker_index[w] = index;
+                worker_best[w].seed = seeds[i];
+                worker_best[w].score = scores[i];
+                worker_best[w].status = status;
+                worker_best[w].teams = move(teams);
+                worker_best[w].unassigned = builder.unassignedStudents();
+            }
+        }
+    };
+
+    vector<thread> pool;
+    for (unsigned w = 1; w < threads; ++w) {
+        pool.emplace_back(worker, w);
+    }
+    worker(0);
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    // The overall winner is always retained by the worker that published it
+    uint32_t winner = best_index.load();
+    for (unsigned w = 0; w < threads; ++w) {
+        if (worker_index[w] == winner) {
+            best_result = move(worker_best[w]);
+        }
+    }
+    return best_result;
+}
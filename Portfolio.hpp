@@ -0,0 +1,38 @@
+#ifndef PORTFOLIO_HPP
+#define PORTFOLIO_HPP
+
+#include "TeamBuilder.hpp"
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+struct PortfolioResult {
+    uint64_t seed = 0;
+    double score = 0.0;
+    FormationStatus status = FormationStatus::Infeasible;
+    std::vector<std::vector<uint32_t>> teams;
+    std::vector<uint32_t> unassigned;
+};
+
+// Runs one seeded formation (plus optimizer pass, if enabled) per seed on a pool of
+// worker threads. Workers share only the read-only roster; each builds its own
+// TeamBuilder. The winner is the highest score, ties going to the earlier seed, so
+// the result depends only on the seed list and not on thread timing.
+class PortfolioSearch {
+public:
+    PortfolioSearch(std::shared_ptr<const Roster> roster, int team_size, bool prioritize_skills);
+    void setSolverBudget(const SolverBudget& budget) { solver_budget = budget; }
+    void setOptimizerOptions(const OptimizerOptions& options) { optimizer_options = options; }
+
+    // threads == 0 uses every available core
+    PortfolioResult run(const std::vector<uint64_t>& seeds, bool prioritize_preferences, unsigned threads = 0);
+
+private:
+    std::shared_ptr<const Roster> roster;
+    int team_size;
+    bool prioritize_skills;
+    SolverBudget solver_budget;
+    OptimizerOptions optimizer_options;
+};
+
+#endif // PORTFOLIO_HPP
@@ -0,0 +1,454 @@
+#include "Roster.hpp"
+#include "Instrumentation.hpp"
+#include <algorithm>
+
+using namespace std;
+
+Roster::Roster(const vector<Student>& source) {
+    STATS_TIMER(MapLoad);
+    students.reserve(source.size());
+    for (const Student& student : source) {
+        students.push_back(intern(student));
+    }
+    indexUsernames();
+    resolvePreferences();
+    packSkills();
+}
+
+Roster::Roster(vector<Student>&& source, Arena&& names) : arena(move(names)), students(move(source)) {
+    STATS_TIMER(MapLoad);
+    indexUsernames();
+    resolvePreferences();
+    packSkills();
+}
+
+Roster::Roster(ResolvedRoster&& resolved)
+    : arena(move(resolved.arena)), students(move(resolved.students)), unresolved(move(resolved.unresolved)) {
+    STATS_TIMER(MapLoad);
+    indexUsernames();
+    uint32_t n = size();
+    // The CSR arrays are already in the arena; each list views its slice in place
+    auto attach = [&](const uint32_t* offsets, uint32_t* flat, vector<IdList>& lists) {
+        lists.resize(n);
+        for (uint32_t id = 0; id < n; ++id) {
+            lists[id] = IdList(flat + offsets[id], offsets[id + 1] - offsets[id]);
+        }
+    };
+    attach(resolved.want_offsets, resolved.want_ids, want_ids);
+    attach(resolved.conflict_offsets, resolved.conflict_ids, conflict_ids);
+    deriveWantedBy();
+    dense_matrix = n <= kDenseConflictLimit;
+    buildConflictRows();
+    packSkills();
+}
+
+Roster::Roster(const Roster& other)
+    : conflict_row(other.conflict_row), conflict_rows(other.conflict_rows),
+      skill_columns{other.skill_columns[0], other.skill_columns[1], other.skill_columns[2]},
+      packed_skills(other.packed_skills), max_skill(other.max_skill), dense_matrix(other.dense_matrix) {
+    students.reserve(other.students.size());
+    for (const Student& student : other.students) {
+        students.push_back(intern(student));
+    }
+    indexUsernames();
+    for (auto lists : {make_pair(&other.want_ids, &want_ids), make_pair(&other.wanted_by_ids, &wanted_by_ids),
+                       make_pair(&other.conflict_ids, &conflict_ids)}) {
+        lists.second->resize(lists.first->size());
+        for (size_t id = 0; id < lists.first->size(); ++id) {
+            (*lists.second)[id].assign(arena, (*lists.first)[id].begin(), (*lists.first)[id].size());
+        }
+    }
+    unresolved.reserve(other.unresolved.size());
+    for (const auto& entry : other.unresolved) {
+        unresolved.emplace(arena.copy(entry.first), entry.second);
+    }
+}
+
+// Copy a student's username and name lists into the roster's arena
+Student Roster::intern(const Student& student) {
+    Student interned = student;
+    interned.username = arena.copy(student.username);
+    interned.want_to_work_with = internNames(student.want_to_work_with.data(), student.want_to_work_with.size());
+    interned.dont_want_to_work_with =
+        internNames(student.dont_want_to_work_with.data(), student.dont_want_to_work_with.size());
+    return interned;
+}
+
+Span<string_view> Roster::internNames(const string_view* names, size_t count) {
+    if (count == 0) return Span<string_view>();
+    string_view* copied = arena.allocateArray<string_view>(count);
+    for (size_t i = 0; i < count; ++i) {
+        copied[i] = arena.copy(names[i]);
+    }
+    return Span<string_view>(copied, count);
+}
+
+// Intern every username to its index in the roster
+void Roster::indexUsernames() {
+    ids.reserve(students.size());
+    for (uint32_t id = 0; id < students.size(); ++id) {
+        students[id].id = id;
+        ids.emplace(students[id].username, id);
+    }
+}
+
+void Roster::packSkills() {
+    uint32_t n = size();
+    for (auto& column : skill_columns) {
+        column.resize(n);
+    }
+    packed_skills.resize(n);
+    for (uint32_t id = 0; id < n; ++id) {
+        packSkill(id);
+    }
+}
+
+void Roster::packSkill(uint32_t id) {
+    const Student& s = students[id];
+    int levels[3] = {s.programming_skill, s.debugging_skill, s.algorithm_skill};
+    for (int k = 0; k < 3; ++k) {
+        uint8_t level = static_cast<uint8_t>(std::min(std::max(levels[k], 0), 255));
+        skill_columns[k][id] = level;
+        max_skill = std::max<uint32_t>(max_skill, level);
+    }
+    packed_skills[id] = skill_columns[0][id] | skill_columns[1][id] << kSkillLaneBits |
+                        uint32_t(skill_columns[2][id]) << (2 * kSkillLaneBits);
+}
+
+array<int, 3> Roster::skillTotals(const uint32_t* members, size_t count) const {
+    // Packed lanes only hold sums up to kSkillLaneMask; bigger groups add the columns separately
+    if (count * max_skill > kSkillLaneMask) {
+        array<int, 3> totals = {{0, 0, 0}};
+        for (size_t i = 0; i < count; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                totals[k] += skill_columns[k][members[i]];
+            }
+        }
+        return totals;
+    }
+
+    // Two independent accumulators keep the gathers from serialising on one add chain
+    uint32_t sum0 = 0, sum1 = 0;
+    size_t i = 0;
+    for (; i + 1 < count; i += 2) {
+        sum0 += packed_skills[members[i]];
+        sum1 += packed_skills[members[i + 1]];
+    }
+    if (i < count) {
+        sum0 += packed_skills[members[i]];
+    }
+    return unpackSkills(sum0 + sum1);
+}
+
+uint32_t Roster::find(string_view username) const {
+    auto it = ids.find(username);
+    return it == ids.end() ? kNoStudent : it->second;
+}
+
+// Resolve want/dont_want username lists into ID adjacency lists and the conflict matrix. Every
+// list is sized before it is filled, so each takes exactly one slot in the arena.
+void Roster::resolvePreferences() {
+    uint32_t n = size();
+    want_ids.assign(n, IdList());
+    conflict_ids.assign(n, IdList());
+
+    dense_matrix = n <= kDenseConflictLimit;
+    unresolved.clear();
+
+    vector<uint32_t> wanted;
+    // Conflicts are symmetric, so each resolved pair is recorded on both ends once all are counted
+    vector<pair<uint32_t, uint32_t>> conflict_pairs;
+    vector<uint32_t> conflict_count(n, 0);
+    for (uint32_t id = 0; id < n; ++id) {
+        wanted.clear();
+        for (string_view name : students[id].want_to_work_with) {
+            uint32_t other = find(name);
+            if (other == kNoStudent) {
+                unresolved[name].push_back(id);
+            } else if (other != id && std::find(wanted.begin(), wanted.end(), other) == wanted.end()) {
+                wanted.push_back(other);
+            }
+        }
+        want_ids[id].assign(arena, wanted.data(), wanted.size());
+        for (string_view name : students[id].dont_want_to_work_with) {
+            uint32_t other = find(name);
+            if (other == kNoStudent) {
+                unresolved[name].push_back(id);
+            } else if (other != id) {
+                conflict_pairs.emplace_back(id, other);
+                ++conflict_count[id];
+                ++conflict_count[other];
+            }
+        }
+    }
+    for (uint32_t id = 0; id < n; ++id) {
+        conflict_ids[id].reserve(arena, conflict_count[id]);
+    }
+    for (const auto& edge : conflict_pairs) {
+        conflict_ids[edge.first].push_back(arena, edge.second);
+        conflict_ids[edge.second].push_back(arena, edge.first);
+    }
+    deriveWantedBy();
+    buildConflictRows();
+}
+
+// Invert the want lists, keeping each wanted-by list in ID order
+void Roster::deriveWantedBy() {
+    uint32_t n = size();
+    vector<uint32_t> count(n, 0);
+    for (uint32_t id = 0; id < n; ++id) {
+        for (uint32_t other : want_ids[id]) {
+            ++count[other];
+        }
+    }
+    wanted_by_ids.assign(n, IdList());
+    for (uint32_t id = 0; id < n; ++id) {
+        wanted_by_ids[id].reserve(arena, count[id]);
+    }
+    for (uint32_t id = 0; id < n; ++id) {
+        for (uint32_t other : want_ids[id]) {
+            wanted_by_ids[other].push_back(arena, id);
+        }
+    }
+}
+
+// Sort and deduplicate the conflict lists, and on dense rosters give each student with a conflict a matrix row
+void Roster::buildConflictRows() {
+    uint32_t n = size();
+    conflict_row.assign(n, kNoStudent);
+    conflict_rows.clear();
+    for (uint32_t id = 0; id < n; ++id) {
+        IdList& list = conflict_ids[id];
+        sort(list.begin(), list.end());
+        list.truncate(unique(list.begin(), list.end()));
+        if (list.empty() || !dense()) continue;
+
+        conflict_row[id] = static_cast<uint32_t>(conflict_rows.size());
+        conflict_rows.emplace_back(n);
+        for (uint32_t other : list) {
+            conflict_rows.back().set(other);
+        }
+    }
+}
+
+// Resolve one student's own preference lists; names not on the roster wait in `unresolved`
+void Roster::linkStudent(uint32_t id) {
+    for (string_view name : students[id].want_to_work_with) {
+        uint32_t other = find(name);
+        if (other == kNoStudent) {
+            unresolved[name].push_back(id);
+        } else if (other != id && std::find(want_ids[id].begin(), want_ids[id].end(), other) == want_ids[id].end()) {
+            want_ids[id].push_back(arena, other);
+            wanted_by_ids[other].push_back(arena, id);
+        }
+    }
+    for (string_view name : students[id].dont_want_to_work_with) {
+        uint32_t other = find(name);
+        if (other == kNoStudent) {
+            unresolved[name].push_back(id);
+        } else if (other != id) {
+            addConflict(id, other);
+        }
+    }
+}
+
+// Link the edges `referrer` listed towards `id` before `id` was on the roster
+void Roster::linkReferrer(uint32_t referrer, uint32_t id) {
+    const Student& s = students[referrer];
+    string_view name = students[id].username;
+    if (std::find(s.want_to_work_with.begin(), s.want_to_work_with.end(), name) != s.want_to_work_with.end() &&
+        std::find(want_ids[referrer].begin(), want_ids[referrer].end(), id) == want_ids[referrer].end()) {
+        want_ids[referrer].push_back(arena, id);
+        wanted_by_ids[id].push_back(arena, referrer);
+    }
+    if (std::find(s.dont_want_to_work_with.begin(), s.dont_want_to_work_with.end(), name) !=
+        s.dont_want_to_work_with.end()) {
+        addConflict(referrer, id);
+    }
+}
+
+// Record a conflict on both ends; a no-op if the pair already conflicts
+void Roster::addConflict(uint32_t a, uint32_t b) {
+    IdList& list_a = conflict_ids[a];
+    uint32_t* at = lower_bound(list_a.begin(), list_a.end(), b);
+    if (at != list_a.end() && *at == b) return;
+    list_a.insert(arena, at, b);
+    IdList& list_b = conflict_ids[b];
+    list_b.insert(arena, lower_bound(list_b.begin(), list_b.end(), a), a);
+    if (!dense_matrix) return;
+
+    for (uint32_t id : {a, b}) {
+        if (conflict_row[id] == kNoStudent) {
+            conflict_row[id] = static_cast<uint32_t>(conflict_rows.size());
+            conflict_rows.emplace_back(size());
+        }
+    }
+    conflict_rows[conflict_row[a]].grow(size());
+    conflict_rows[conflict_row[a]].set(b);
+    conflict_rows[conflict_row[b]].grow(size());
+    conflict_rows[conflict_row[b]].set(a);
+}
+
+void Roster::removeConflict(uint32_t a, uint32_t b) {
+    IdList& list_a = conflict_ids[a];
+    uint32_t* at = lower_bound(list_a.begin(), list_a.end(), b);
+    if (at == list_a.end() || *at != b) return;
+    list_a.erase(at);
+    IdList& list_b = conflict_ids[b];
+    list_b.erase(lower_bound(list_b.begin(), list_b.end(), a));
+    if (conflict_row[a] != kNoStudent) conflict_rows[conflict_row[a]].reset(b);
+    if (conflict_row[b] != kNoStudent) conflict_rows[conflict_row[b]].reset(a);
+}
+
+// Drop `id` from the waiting lists of every name it listed that is not on the roster
+void Roster::forgetUnresolved(uint32_t id) {
+    const Student& s = students[id];
+    for (const auto* names : {&s.want_to_work_with, &s.dont_want_to_work_with}) {
+        for (string_view name : *names) {
+            auto it = unresolved.find(name);
+            if (it == unresolved.end()) continue;
+            auto& referrers = it->second;
+            referrers.erase(remove(referrers.begin(), referrers.end(), id), referrers.end());
+            if (referrers.empty()) unresolved.erase(it);
+        }
+    }
+}
+
+uint32_t Roster::addStudent(const Student& student) {
+    uint32_t id = size();
+    if (ids.count(student.username) > 0) return kNoStudent;
+    students.push_back(intern(student));
+    students[id].id = id;
+    ids.emplace(students[id].username, id);
+    want_ids.emplace_back();
+    wanted_by_ids.emplace_back();
+    conflict_ids.emplace_back();
+    conflict_row.push_back(kNoStudent);
+    for (auto& column : skill_columns) {
+        column.push_back(0);
+    }
+    packed_skills.push_back(0);
+    packSkill(id);
+
+    linkStudent(id);
+    // Students who listed this username before it was on the roster
+    auto waiting = unresolved.find(students[id].username);
+    if (waiting != unresolved.end()) {
+        vector<uint32_t> referrers = move(waiting->second);
+        unresolved.erase(waiting);
+        for (uint32_t referrer : referrers) {
+            linkReferrer(referrer, id);
+        }
+    }
+    return id;
+}
+
+uint32_t Roster::removeStudent(uint32_t id) {
+    forgetUnresolved(id);
+    // The name's bytes stay in the arena after the student is gone
+    string_view name = students[id].username;
+
+    // Anyone who listed the leaver waits for a student of that name to join again
+    for (uint32_t referrer : wanted_by_ids[id]) {
+        auto& wants = want_ids[referrer];
+        wants.erase(std::find(wants.begin(), wants.end(), id));
+        unresolved[name].push_back(referrer);
+    }
+    for (uint32_t wanted : want_ids[id]) {
+        auto& wanted_by = wanted_by_ids[wanted];
+        wanted_by.erase(std::find(wanted_by.begin(), wanted_by.end(), id));
+    }
+    vector<uint32_t> partners(conflict_ids[id].begin(), conflict_ids[id].end());
+    for (uint32_t partner : partners) {
+        Span<string_view> listed = students[partner].dont_want_to_work_with;
+        if (std::find(listed.begin(), listed.end(), name) != listed.end()) {
+            unresolved[name].push_back(partner);
+        }
+        removeConflict(id, partner);
+    }
+    if (conflict_row[id] != kNoStudent) {
+        conflict_rows[conflict_row[id]].release();
+    }
+    ids.erase(name);
+
+    uint32_t last = size() - 1;
+    if (id != last) {
+        moveStudent(last, id);
+    }
+    students.pop_back();
+    want_ids.pop_back();
+    wanted_by_ids.pop_back();
+    conflict_ids.pop_back();
+    conflict_row.pop_back();
+    for (auto& column : skill_columns) {
+        column.pop_back();
+    }
+    packed_skills.pop_back();
+    return id != last ? last : kNoStudent;
+}
+
+// Renumber a student, rewriting every reference to its old ID
+void Roster::moveStudent(uint32_t from, uint32_t to) {
+    for (uint32_t wanted : want_ids[from]) {
+        replace(wanted_by_ids[wanted].begin(), wanted_by_ids[wanted].end(), from, to);
+    }
+    for (uint32_t referrer : wanted_by_ids[from]) {
+        replace(want_ids[referrer].begin(), want_ids[referrer].end(), from, to);
+    }
+    for (uint32_t partner : conflict_ids[from]) {
+        IdList& list = conflict_ids[partner];
+        list.erase(lower_bound(list.begin(), list.end(), from));
+        list.insert(arena, lower_bound(list.begin(), list.end(), to), to);
+        if (conflict_row[partner] != kNoStudent) {
+            conflict_rows[conflict_row[partner]].reset(from);
+            conflict_rows[conflict_row[partner]].set(to);
+        }
+    }
+    const Student& s = students[from];
+    for (const auto* names : {&s.want_to_work_with, &s.dont_want_to_work_with}) {
+        for (string_view name : *names) {
+            auto it = unresolved.find(name);
+            if (it != unresolved.end()) {
+                replace(it->second.begin(), it->second.end(), from, to);
+            }
+        }
+    }
+
+    students[to] = students[from];
+    students[to].id = to;
+    ids[students[to].username] = to;
+    want_ids[to] = want_ids[from];
+    wanted_by_ids[to] = wanted_by_ids[from];
+    conflict_ids[to] = conflict_ids[from];
+    conflict_row[to] = conflict_row[from];
+    for (auto& column : skill_columns) {
+        column[to] = column[from];
+    }
+    packed_skills[to] = packed_skills[from];
+}
+
+void Roster::updatePreferences(uint32_t id, const vector<string>& want_to_work_with,
+                               const vector<string>& dont_want_to_work_with) {
+    forgetUnresolved(id);
+    for (uint32_t wanted : want_ids[id]) {
+        IdList& wanted_by = wanted_by_ids[wanted];
+        wanted_by.erase(std::find(wanted_by.begin(), wanted_by.end(), id));
+    }
+    want_ids[id].clear();
+    // A conflict stays if the other student listed this one too
+    string_view name = students[id].username;
+    vector<uint32_t> partners(conflict_ids[id].begin(), conflict_ids[id].end());
+    for (uint32_t partner : partners) {
+        Span<string_view> listed = students[partner].dont_want_to_work_with;
+        if (std::find(listed.begin(), listed.end(), name) == listed.end()) {
+            removeConflict(id, partner);
+        }
+    }
+
+    // The old lists stay in the arena; the new ones are interned alongside them
+    vector<string_view> wants(want_to_work_with.begin(), want_to_work_with.end());
+    vector<string_view> avoids(dont_want_to_work_with.begin(), dont_want_to_work_with.end());
+    students[id].want_to_work_with = internNames(wants.data(), wants.size());
+    students[id].dont_want_to_work_with = internNames(avoids.data(), avoids.size());
+    linkStudent(id);
+}
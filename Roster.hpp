@@ -0,0 +1,280 @@
+#ifndef ROSTER_HPP
+#define ROSTER_HPP
+
+#include "Student.hpp"
+#include "Arena.hpp"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+const uint32_t kNoStudent = UINT32_MAX;
+
+// Width of each skill's lane in a packed skill word
+const uint32_t kSkillLaneBits = 10;
+const uint32_t kSkillLaneMask = (1u << kSkillLaneBits) - 1;
+
+// Rosters up to this size keep the conflict matrix and per-team forbidden sets as
+// bitsets. Past it the n-bit rows would cost too much memory, so conflicts fall
+// back to sorted ID lists.
+const uint32_t kDenseConflictLimit = 16384;
+
+// Fixed-width bitset indexed by student ID
+class StudentBitset {
+public:
+    StudentBitset() {}
+    explicit StudentBitset(uint32_t num_students) : words((num_students + 63) / 64, 0) {}
+
+    bool empty() const { return words.empty(); }
+    bool test(uint32_t id) const {
+        // Bits past the allocated width (including every bit of an unallocated bitset) are clear
+        return (id >> 6) < words.size() && ((words[id >> 6] >> (id & 63)) & 1);
+    }
+    void set(uint32_t id) { words[id >> 6] |= uint64_t(1) << (id & 63); }
+    void reset(uint32_t id) {
+        if ((id >> 6) < words.size()) words[id >> 6] &= ~(uint64_t(1) << (id & 63));
+    }
+    // Widen to hold IDs below num_students, for students added after the roster was built
+    void grow(uint32_t num_students) {
+        size_t needed = (num_students + 63) / 64;
+        if (needed > words.size()) words.resize(std::max(needed, words.size() * 2), 0);
+    }
+    void clear() { words.assign(words.size(), 0); }
+    void release() { std::vector<uint64_t>().swap(words); }
+    size_t bytes() const { return words.capacity() * sizeof(uint64_t); }
+    void allocate(uint32_t num_students) { words.assign((num_students + 63) / 64, 0); }
+    void orWith(const StudentBitset& other) {
+        if (other.words.size() > words.size()) words.resize(other.words.size(), 0);
+        for (size_t i = 0; i < other.words.size(); ++i) {
+            words[i] |= other.words[i];
+        }
+    }
+
+private:
+    std::vector<uint64_t> words;
+};
+
+// One student's adjacency list, stored in the roster's arena. Lists are built at their final
+// size; one that outgrows its slot in an incremental change moves to a slot twice as large,
+// and the old slot is only reclaimed with the arena.
+class IdList {
+public:
+    IdList() = default;
+    // A list filling a slot the caller already carved from the arena
+    IdList(uint32_t* ids, size_t size)
+        : first(ids), count(static_cast<uint32_t>(size)), capacity(static_cast<uint32_t>(size)) {}
+
+    uint32_t* begin() { return first; }
+    uint32_t* end() { return first + count; }
+    const uint32_t* begin() const { return first; }
+    const uint32_t* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    Span<uint32_t> view() const { return Span<uint32_t>(first, count); }
+
+    void assign(Arena& arena, const uint32_t* ids, size_t size) {
+        count = 0;
+        reserve(arena, size);
+        std::copy(ids, ids + size, first);
+        count = static_cast<uint32_t>(size);
+    }
+    void reserve(Arena& arena, size_t wanted) {
+        if (wanted <= capacity) return;
+        uint32_t* moved = arena.allocateArray<uint32_t>(wanted);
+        std::copy(first, first + count, moved);
+        first = moved;
+        capacity = static_cast<uint32_t>(wanted);
+    }
+    void push_back(Arena& arena, uint32_t id) {
+        if (count == capacity) reserve(arena, std::max<size_t>(4, 2 * size_t(capacity)));
+        first[count++] = id;
+    }
+    void insert(Arena& arena, uint32_t* position, uint32_t id) {
+        size_t index = position - first;
+        push_back(arena, id);
+        std::rotate(first + index, first + count - 1, first + count);
+    }
+    void erase(uint32_t* position) {
+        std::copy(position + 1, end(), position);
+        --count;
+    }
+    // Drop everything from `new_end` on, e.g. after std::unique
+    void truncate(uint32_t* new_end) { count = static_cast<uint32_t>(new_end - first); }
+    void clear() { count = 0; }
+
+private:
+    uint32_t* first = nullptr;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+};
+
+// A roster's students with their preference lists already resolved to IDs, as restored from a
+// snapshot (see RosterSnapshot.hpp). The students and the adjacency arrays live in `arena`, which
+// the roster takes over, so its lists view the arrays where the loader put them. Adjacency is in
+// CSR form with students.size() + 1 offsets: student i's wants are
+// want_ids[want_offsets[i]..want_offsets[i+1]), in listing order without duplicates or
+// self-references; conflicts are sorted and symmetric.
+struct ResolvedRoster {
+    Arena arena;
+    std::vector<Student> students;
+    uint32_t* want_offsets = nullptr;
+    uint32_t* want_ids = nullptr;
+    uint32_t* conflict_offsets = nullptr;
+    uint32_t* conflict_ids = nullptr;
+    std::unordered_map<std::string_view, std::vector<uint32_t>> unresolved;
+};
+
+// Roster: owns the students, interns usernames to dense IDs and resolves preference
+// lists once into ID adjacency lists and a conflict matrix. Shared rosters are treated
+// as immutable; a builder that owns its roster may patch it in place as students
+// join, leave or change their preferences.
+class Roster {
+public:
+    // Copies the students' names into the roster's own arena
+    explicit Roster(const std::vector<Student>& students);
+    // Takes over the arena the students' names live in, as filled by the parser
+    Roster(std::vector<Student>&& students, Arena&& arena);
+    // Skips name resolution; only the username index, wanted-by lists and conflict matrix are built
+    explicit Roster(ResolvedRoster&& resolved);
+    // A copy gets its own arena, so either roster may then be edited or dropped independently
+    Roster(const Roster& other);
+    Roster(Roster&&) = default;
+    Roster& operator=(const Roster&) = delete;
+
+    uint32_t size() const { return static_cast<uint32_t>(students.size()); }
+    const Student& student(uint32_t id) const { return students[id]; }
+    const std::vector<Student>& all() const { return students; }
+
+    // Skill levels as packed columns (0 programming, 1 debugging, 2 algorithm)
+    uint8_t skill(int column, uint32_t id) const { return skill_columns[column][id]; }
+    const std::vector<uint8_t>& skillColumn(int column) const { return skill_columns[column]; }
+    // Sum the three skills over `count` members
+    std::array<int, 3> skillTotals(const uint32_t* members, size_t count) const;
+    // Same sum for a member count fixed at compile time, so the gather loop fully unrolls
+    template <size_t N>
+    std::array<int, 3> skillTotals(const uint32_t* members) const {
+        if (N == 0 || N * max_skill > kSkillLaneMask) return skillTotals(members, N);
+        uint32_t sum = 0;
+        for (size_t i = 0; i < N; ++i) {
+            sum += packed_skills[members[i]];
+        }
+        return unpackSkills(sum);
+    }
+
+    // Returns kNoStudent for usernames not on the roster
+    uint32_t find(std::string_view username) const;
+
+    Span<uint32_t> wants(uint32_t id) const { return want_ids[id].view(); }
+    Span<uint32_t> wantedBy(uint32_t id) const { return wanted_by_ids[id].view(); }
+    Span<uint32_t> conflicts(uint32_t id) const { return conflict_ids[id].view(); }
+
+    // Symmetric: true if either student listed the other as dont_want_to_work_with
+    bool hasConflict(uint32_t a, uint32_t b) const {
+        if (dense()) {
+            return conflict_row[a] != kNoStudent && conflict_rows[conflict_row[a]].test(b);
+        }
+        return std::binary_search(conflict_ids[a].begin(), conflict_ids[a].end(), b);
+    }
+    // Fixed when the roster is built, so students added later never switch representations
+    bool dense() const { return dense_matrix; }
+
+    // Row of the conflict matrix, or nullptr for students with no conflicts (and for every student on sparse rosters)
+    const StudentBitset* conflictRow(uint32_t id) const {
+        return conflict_row[id] == kNoStudent ? nullptr : &conflict_rows[conflict_row[id]];
+    }
+
+    // Incremental edits. Each keeps the adjacency lists, conflict matrix and skill columns
+    // current in time proportional to the students involved, not the roster.
+    // Returns the new student's ID, or kNoStudent if the username is already taken. The
+    // student's names are copied, so they may live anywhere.
+    uint32_t addStudent(const Student& student);
+    // The last student takes over the freed ID; returns that student's old ID, or
+    // kNoStudent if the removed student was last
+    uint32_t removeStudent(uint32_t id);
+    void updatePreferences(uint32_t id, const std::vector<std::string>& want_to_work_with,
+                           const std::vector<std::string>& dont_want_to_work_with);
+
+    // Bytes the roster's arena holds for names, name lists and adjacency
+    size_t arenaBytes() const { return arena.bytesReserved(); }
+
+private:
+    // Owns every name and adjacency list the members below point into; declared first so it
+    // outlives them
+    Arena arena;
+    std::vector<Student> students;
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::vector<IdList> want_ids;
+    std::vector<IdList> wanted_by_ids;
+    std::vector<IdList> conflict_ids;
+    // Matrix rows are only materialised for students that take part in a conflict
+    std::vector<uint32_t> conflict_row;
+    std::vector<StudentBitset> conflict_rows;
+    std::vector<uint8_t> skill_columns[3];
+    // All three skills of a student in one word, kSkillLaneBits per skill, so a single
+    // add per member accumulates every column at once
+    std::vector<uint32_t> packed_skills;
+    uint32_t max_skill = 0;  // Never lowered on removal; it only guards the packed sums
+    bool dense_matrix = false;
+    // Usernames listed by some student but not on the roster, with the students who listed
+    // them, so a student who joins later is linked without rescanning every list
+    std::unordered_map<std::string_view, std::vector<uint32_t>> unresolved;
+
+    static std::array<int, 3> unpackSkills(uint32_t sum) {
+        return {{static_cast<int>(sum & kSkillLaneMask), static_cast<int>((sum >> kSkillLaneBits) & kSkillLaneMask),
+                 static_cast<int>(sum >> (2 * kSkillLaneBits))}};
+    }
+    Student intern(const Student& student);
+    Span<std::string_view> internNames(const std::string_view* names, size_t count);
+    void indexUsernames();
+    void resolvePreferences();
+    void deriveWantedBy();
+    void buildConflictRows();
+    void packSkills();
+    void packSkill(uint32_t id);
+    void linkStudent(uint32_t id);
+    void linkReferrer(uint32_t referrer, uint32_t id);
+    void addConflict(uint32_t a, uint32_t b);
+    void removeConflict(uint32_t a, uint32_t b);
+    void forgetUnresolved(uint32_t id);
+    void moveStudent(uint32_t from, uint32_t to);
+};
+
+// The students a team may not take: the union of its members' conflicts. On dense
+// rosters this is a bitset, so a membership test is one word AND; on sparse ones it
+// is the sorted union of the members' conflict lists.
+class ForbiddenSet {
+public:
+    bool contains(uint32_t id) const {
+        if (!bits.empty()) return bits.test(id);
+        return !ids.empty() && std::binary_search(ids.begin(), ids.end(), id);
+    }
+    void add(const Roster& roster, uint32_t member) {
+        const StudentBitset* row = roster.conflictRow(member);
+        if (row) {
+            if (bits.empty()) {
+                bits.allocate(roster.size());
+            }
+            bits.orWith(*row);
+            return;
+        }
+        Span<uint32_t> conflicts = roster.conflicts(member);
+        if (conflicts.empty()) return;
+        size_t middle = ids.size();
+        ids.insert(ids.end(), conflicts.begin(), conflicts.end());
+        std::inplace_merge(ids.begin(), ids.begin() + middle, ids.end());
+    }
+    void clear() {
+        bits.release();
+        std::vector<uint32_t>().swap(ids);
+    }
+    size_t bytes() const { return bits.bytes() + ids.capacity() * sizeof(uint32_t); }
+
+private:
+    StudentBitset bits;
+    std::vector<uint32_t> ids;
+};
+
+#endif // ROSTER_HPP
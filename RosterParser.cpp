@@ -0,0 +1,168 @@
+#include "RosterParser.hpp"
+#include "Utilities.hpp"
+#include "Instrumentation.hpp"
+#include <cstring>
+#include <thread>
+#include <algorithm>
+
+using namespace std;
+
+// Chunks smaller than this are not worth a thread of their own
+const size_t kMinChunkBytes = 1 << 20;
+
+namespace {
+
+struct ChunkResult {
+    Arena arena;
+    vector<Student> students;
+    vector<ParseError> errors;  // Line numbers are relative to the chunk until merged
+    size_t lines = 0;
+};
+
+// Split off the next `delimiter`-terminated field
+string_view nextField(string_view& rest, char delimiter) {
+    size_t pos = rest.find(delimiter);
+    string_view field = rest.substr(0, pos);
+    rest = pos == string_view::npos ? string_view() : rest.substr(pos + 1);
+    return field;
+}
+
+string_view copyLowerCase(Arena& arena, string_view text) {
+    char* out = arena.allocateArray<char>(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        out[i] = static_cast<char>(tolower(static_cast<unsigned char>(text[i])));
+    }
+    return string_view(out, text.size());
+}
+
+// `scratch` collects the names before they are laid out in the arena as one array
+Span<string_view> parseNameList(string_view list, Arena& arena, vector<string_view>& scratch) {
+    scratch.clear();
+    while (!list.empty()) {
+        string_view name = trimView(nextField(list, ';'));
+        if (!name.empty()) {
+            scratch.push_back(copyLowerCase(arena, name));
+        }
+    }
+    return arena.copy(scratch.data(), scratch.size());
+}
+
+// Parse one row into `student`; on failure returns false and fills `message`
+bool parseRow(string_view row, Student& student, Arena& arena, vector<string_view>& scratch, string& message) {
+    string_view rest = row;
+    string_view username = trimView(nextField(rest, ','));
+    if (username.empty()) {
+        message = "missing username";
+        return false;
+    }
+
+    int* skills[3] = {&student.programming_skill, &student.debugging_skill, &student.algorithm_skill};
+    for (int k = 0; k < 3; ++k) {
+        if (rest.data() == nullptr) {
+            message = "expected 3 skill levels";
+            return false;
+        }
+        string_view skill = trimView(nextField(rest, ','));
+        *skills[k] = skillLevelFromView(skill);
+        if (*skills[k] == 0) {
+            message = "Invalid skill level: " + string(skill);
+            return false;
+        }
+    }
+
+    student.username = copyLowerCase(arena, username);
+    student.dont_want_to_work_with = parseNameList(nextField(rest, ','), arena, scratch);
+    student.want_to_work_with = parseNameList(nextField(rest, ','), arena, scratch);
+    return true;
+}
+
+void parseChunk(string_view chunk, ChunkResult& result) {
+    string message;
+    vector<string_view> scratch;
+    while (!chunk.empty()) {
+        size_t pos = chunk.find('\n');
+        string_view row = chunk.substr(0, pos);
+        chunk = pos == string_view::npos ? string_view() : chunk.substr(pos + 1);
+        ++result.lines;
+
+        if (!row.empty() && row.back() == '\r') {
+            row.remove_suffix(1);
+        }
+        if (trimView(row).empty()) continue;
+
+        result.students.emplace_back();
+        if (!parseRow(row, result.students.back(), result.arena, scratch, message)) {
+            result.students.pop_back();
+            result.errors.push_back({result.lines, message});
+        }
+    }
+}
+
+} // namespace
+
+ParseResult parseRosterBuffer(string_view data, unsigned threads) {
+    STATS_TIMER(Parse);
+    ParseResult result;
+    result.opened = true;
+
+    // Skip the header line
+    size_t header_end = data.find('\n');
+    if (header_end == string_view::npos) {
+        return result;
+    }
+    string_view body = data.substr(header_end + 1);
+
+    // Cut the body into roughly equal chunks, each ending on a newline
+    size_t num_chunks = max<size_t>(1, min<size_t>(threads, body.size() / kMinChunkBytes));
+    vector<string_view> chunks;
+    size_t start = 0;
+    for (size_t c = 1; c <= num_chunks && start < body.size(); ++c) {
+        size_t end = c == num_chunks ? body.size() : max(start, body.size() * c / num_chunks);
+        if (end < body.size()) {
+            size_t newline = body.find('\n', end);
+            end = newline == string_view::npos ? body.size() : newline + 1;
+        }
+        chunks.push_back(body.substr(start, end - start));
+        start = end;
+    }
+
+    vector<ChunkResult> parsed(chunks.size());
+    if (chunks.size() == 1) {
+        parseChunk(chunks[0], parsed[0]);
+    } else {
+        vector<thread> workers;
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            workers.emplace_back(parseChunk, chunks[c], ref(parsed[c]));
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Merge in file order, shifting each chunk's line numbers past the header and earlier chunks
+    size_t total = 0;
+    for (const auto& chunk : parsed) {
+        total += chunk.students.size();
+    }
+    result.students.reserve(total);
+    size_t line_offset = 1;
+    for (auto& chunk : parsed) {
+        result.students.insert(result.students.end(), chunk.students.begin(), chunk.students.end());
+        result.arena.adopt(move(chunk.arena));
+        for (auto& error : chunk.errors) {
+            error.line += line_offset;
+            result.errors.push_back(move(error));
+        }
+        line_offset += chunk.lines;
+    }
+    return result;
+}
+
+ParseResult parseRosterFile(const string& filename, unsigned threads) {
+    MappedFile file(filename);
+    if (!file.opened()) {
+        return ParseResult();
+    }
+    file.adviseSequential();
+    return parseRosterBuffer(file.data(), threads);
+}
@@ -0,0 +1,32 @@
+#ifndef ROSTERPARSER_HPP
+#define ROSTERPARSER_HPP
+
+#include "Student.hpp"
+#include "Arena.hpp"
+#include <vector>
+#include <string>
+#include <string_view>
+
+// A row that was skipped, with its 1-based line number in the file
+struct ParseError {
+    size_t line;
+    std::string message;
+};
+
+struct ParseResult {
+    bool opened = false;
+    Arena arena;  // Holds every name the students view; hand it to the Roster with them
+    std::vector<Student> students;
+    std::vector<ParseError> errors;
+};
+
+// Parse a roster CSV (header line, then username, three skill levels,
+// ';'-separated dont_want and want lists). The file is memory-mapped and
+// tokenized in place; names are lowercased as they are copied into the result's
+// arena. With more
+// than one thread, large inputs are split at newline boundaries and the
+// chunks are parsed in parallel; row order and line numbers are preserved.
+ParseResult parseRosterFile(const std::string& filename, unsigned threads = 1);
+ParseResult parseRosterBuffer(std::string_view data, unsigned threads = 1);
+
+#endif // ROSTERPARSER_HPP
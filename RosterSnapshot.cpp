@@ -0,0 +1,362 @@
+#include "RosterSnapshot.hpp"
+#include "Utilities.hpp"
+#include "Instrumentation.hpp"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <unordered_map>
+#include <algorithm>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+const char kSnapshotMagic[8] = {'T', 'B', 'R', 'O', 'S', 'T', 'E', 'R'};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t students;
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint32_t names;             // Usernames in ID order, then names listed but not on the roster
+    uint32_t name_bytes;
+    uint32_t listed_wants;      // Entries in the students' own want_to_work_with lists
+    uint32_t listed_conflicts;  // ... and dont_want_to_work_with lists
+    uint32_t want_edges;
+    uint32_t conflict_edges;    // Each conflict counted on both ends
+    uint32_t errors;
+    uint32_t error_bytes;
+    uint64_t payload_hash;      // hashBytes of everything after the header
+};
+static_assert(sizeof(SnapshotHeader) == 72, "snapshot header layout changed; bump kSnapshotVersion");
+
+size_t alignUp(size_t bytes) {
+    return (bytes + 7) & ~size_t(7);
+}
+
+// Appends sections to the payload, each padded to the next 8-byte boundary
+class SectionWriter {
+public:
+    explicit SectionWriter(string& out) : out(out) {}
+    template <typename T>
+    void write(const T* data, size_t count) {
+        size_t bytes = count * sizeof(T);
+        out.append(reinterpret_cast<const char*>(data), bytes);
+        out.append(alignUp(bytes) - bytes, '\0');
+    }
+    template <typename T>
+    void write(const vector<T>& data) { write(data.data(), data.size()); }
+
+private:
+    string& out;
+};
+
+// Hands out the sections of a mapped snapshot in file order; any read past the end fails the load
+class SectionReader {
+public:
+    explicit SectionReader(string_view data) : data(data) {}
+    template <typename T>
+    const T* read(size_t count) {
+        size_t bytes = count * sizeof(T);
+        if (failed || offset + bytes > data.size()) {
+            failed = true;
+            return nullptr;
+        }
+        const T* section = reinterpret_cast<const T*>(data.data() + offset);
+        offset = alignUp(offset + bytes);
+        return section;
+    }
+    bool ok() const { return !failed && offset == data.size(); }
+
+private:
+    string_view data;
+    size_t offset = sizeof(SnapshotHeader);
+    bool failed = false;
+};
+
+// CSR offsets must start at 0, never decrease and end at the entry count
+bool validOffsets(const uint32_t* offsets, uint32_t rows, uint32_t entries) {
+    if (offsets[0] != 0 || offsets[rows] != entries) return false;
+    for (uint32_t i = 0; i < rows; ++i) {
+        if (offsets[i] > offsets[i + 1]) return false;
+    }
+    return true;
+}
+
+bool allBelow(const uint32_t* values, uint32_t count, uint32_t limit) {
+    for (uint32_t i = 0; i < count; ++i) {
+        if (values[i] >= limit) return false;
+    }
+    return true;
+}
+
+string snapshotDirectory(const SnapshotOptions& options) {
+    if (!options.directory.empty()) return options.directory;
+    if (const char* cache = getenv("TEAMBUILDER_CACHE")) return cache;
+    if (const char* xdg = getenv("XDG_CACHE_HOME")) {
+        if (*xdg) return string(xdg) + "/teambuilder";
+    }
+    if (const char* home = getenv("HOME")) {
+        if (*home) return string(home) + "/.cache/teambuilder";
+    }
+    return string();
+}
+
+bool makeDirectories(const string& path) {
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        string prefix = path.substr(0, slash);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (slash == string::npos) return true;
+    }
+}
+
+} // namespace
+
+bool writeRosterSnapshot(const string& path, const Roster& roster, const vector<ParseError>& errors,
+                         uint64_t source_hash, uint64_t source_size) {
+    uint32_t n = roster.size();
+
+    // Name table: usernames first, so a student's ID is their own name's index
+    vector<uint32_t> name_offsets(1, 0);
+    string name_chars;
+    for (uint32_t id = 0; id < n; ++id) {
+        name_chars += roster.student(id).username;
+        name_offsets.push_back(static_cast<uint32_t>(name_chars.size()));
+    }
+    unordered_map<string_view, uint32_t> extra_names;
+    auto nameIndex = [&](string_view name) {
+        uint32_t id = roster.find(name);
+        if (id != kNoStudent) return id;
+        uint32_t next = n + static_cast<uint32_t>(extra_names.size());
+        auto inserted = extra_names.emplace(name, next);
+        if (inserted.second) {
+            name_chars += name;
+            name_offsets.push_back(static_cast<uint32_t>(name_chars.size()));
+        }
+        return inserted.first->second;
+    };
+
+    vector<uint8_t> skills(3 * size_t(n));
+    vector<uint32_t> listed_want_offsets(1, 0), listed_wants, listed_conflict_offsets(1, 0), listed_conflicts;
+    vector<uint32_t> want_offsets(1, 0), want_ids, conflict_offsets(1, 0), conflict_ids;
+    for (uint32_t id = 0; id < n; ++id) {
+        const Student& s = roster.student(id);
+        for (int k = 0; k < 3; ++k) {
+            skills[size_t(k) * n + id] = roster.skill(k, id);
+        }
+        for (string_view name : s.want_to_work_with) {
+            listed_wants.push_back(nameIndex(name));
+        }
+        listed_want_offsets.push_back(static_cast<uint32_t>(listed_wants.size()));
+        for (string_view name : s.dont_want_to_work_with) {
+            listed_conflicts.push_back(nameIndex(name));
+        }
+        listed_conflict_offsets.push_back(static_cast<uint32_t>(listed_conflicts.size()));
+        want_ids.insert(want_ids.end(), roster.wants(id).begin(), roster.wants(id).end());
+        want_offsets.push_back(static_cast<uint32_t>(want_ids.size()));
+        conflict_ids.insert(conflict_ids.end(), roster.conflicts(id).begin(), roster.conflicts(id).end());
+        conflict_offsets.push_back(static_cast<uint32_t>(conflict_ids.size()));
+    }
+
+    vector<uint64_t> error_lines;
+    vector<uint32_t> error_offsets(1, 0);
+    string error_chars;
+    for (const auto& error : errors) {
+        error_lines.push_back(error.line);
+        error_chars += error.message;
+        error_offsets.push_back(static_cast<uint32_t>(error_chars.size()));
+    }
+    if (name_chars.size() > UINT32_MAX || error_chars.size() > UINT32_MAX) return false;
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.version = kSnapshotVersion;
+    header.students = n;
+    header.source_hash = source_hash;
+    header.source_size = source_size;
+    header.names = static_cast<uint32_t>(name_offsets.size() - 1);
+    header.name_bytes = static_cast<uint32_t>(name_chars.size());
+    header.listed_wants = static_cast<uint32_t>(listed_wants.size());
+    header.listed_conflicts = static_cast<uint32_t>(listed_conflicts.size());
+    header.want_edges = static_cast<uint32_t>(want_ids.size());
+    header.conflict_edges = static_cast<uint32_t>(conflict_ids.size());
+    header.errors = static_cast<uint32_t>(errors.size());
+    header.error_bytes = static_cast<uint32_t>(error_chars.size());
+
+    string payload;
+    SectionWriter sections(payload);
+    sections.write(name_offsets);
+    sections.write(name_chars.data(), name_chars.size());
+    sections.write(skills);
+    sections.write(listed_want_offsets);
+    sections.write(listed_wants);
+    sections.write(listed_conflict_offsets);
+    sections.write(listed_conflicts);
+    sections.write(want_offsets);
+    sections.write(want_ids);
+    sections.write(conflict_offsets);
+    sections.write(conflict_ids);
+    sections.write(error_lines);
+    sections.write(error_offsets);
+    sections.write(error_chars.data(), error_chars.size());
+    header.payload_hash = hashBytes(payload);
+
+    // Written under a temporary name and renamed, so a concurrent reader never sees half a file
+    string temporary = path + ".tmp" + to_string(getpid());
+    {
+        ofstream out(temporary, ios::binary | ios::trunc);
+        if (!out.is_open()) return false;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(payload.data(), payload.size());
+        if (!out.flush()) {
+            out.close();
+            remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readRosterSnapshot(const string& path, uint64_t source_hash, uint64_t source_size, ResolvedRoster& roster,
+                        vector<ParseError>& errors) {
+    STATS_TIMER(Parse);
+    MappedFile file(path);
+    string_view data = file.data();
+    if (!file.opened() || data.size() < sizeof(SnapshotHeader)) return false;
+
+    SnapshotHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 || header.version != kSnapshotVersion ||
+        header.source_hash != source_hash || header.source_size != source_size || header.names < header.students ||
+        hashBytes(data.substr(sizeof(SnapshotHeader))) != header.payload_hash) {
+        return false;
+    }
+
+    uint32_t n = header.students;
+    SectionReader sections(data);
+    const uint32_t* name_offsets = sections.read<uint32_t>(size_t(header.names) + 1);
+    const char* name_chars = sections.read<char>(header.name_bytes);
+    const uint8_t* skills = sections.read<uint8_t>(3 * size_t(n));
+    const uint32_t* listed_want_offsets = sections.read<uint32_t>(size_t(n) + 1);
+    const uint32_t* listed_wants = sections.read<uint32_t>(header.listed_wants);
+    const uint32_t* listed_conflict_offsets = sections.read<uint32_t>(size_t(n) + 1);
+    const uint32_t* listed_conflicts = sections.read<uint32_t>(header.listed_conflicts);
+    const uint32_t* want_offsets = sections.read<uint32_t>(size_t(n) + 1);
+    const uint32_t* want_ids = sections.read<uint32_t>(header.want_edges);
+    const uint32_t* conflict_offsets = sections.read<uint32_t>(size_t(n) + 1);
+    const uint32_t* conflict_ids = sections.read<uint32_t>(header.conflict_edges);
+    const uint64_t* error_lines = sections.read<uint64_t>(header.errors);
+    const uint32_t* error_offsets = sections.read<uint32_t>(size_t(header.errors) + 1);
+    const char* error_chars = sections.read<char>(header.error_bytes);
+    if (!sections.ok() ||
+        !validOffsets(name_offsets, header.names, header.name_bytes) ||
+        !validOffsets(listed_want_offsets, n, header.listed_wants) ||
+        !validOffsets(listed_conflict_offsets, n, header.listed_conflicts) ||
+        !validOffsets(want_offsets, n, header.want_edges) ||
+        !validOffsets(conflict_offsets, n, header.conflict_edges) ||
+        !validOffsets(error_offsets, header.errors, header.error_bytes) ||
+        !allBelow(listed_wants, header.listed_wants, header.names) ||
+        !allBelow(listed_conflicts, header.listed_conflicts, header.names) ||
+        !allBelow(want_ids, header.want_edges, n) || !allBelow(conflict_ids, header.conflict_edges, n)) {
+        return false;
+    }
+
+    // The name table moves into the roster's arena in one copy; students and lists view it there
+    char* chars = roster.arena.allocateArray<char>(header.name_bytes);
+    memcpy(chars, name_chars, header.name_bytes);
+    string_view* names = roster.arena.allocateArray<string_view>(header.names);
+    for (uint32_t index = 0; index < header.names; ++index) {
+        names[index] = string_view(chars + name_offsets[index], name_offsets[index + 1] - name_offsets[index]);
+    }
+    string_view* listed = roster.arena.allocateArray<string_view>(size_t(header.listed_wants) + header.listed_conflicts);
+    string_view* listed_end = listed;
+    auto nameList = [&](const uint32_t* offsets, const uint32_t* indices, uint32_t id) {
+        string_view* first = listed_end;
+        for (uint32_t k = offsets[id]; k < offsets[id + 1]; ++k) {
+            *listed_end++ = names[indices[k]];
+            // Names not on the roster wait in `unresolved` in the order the roster itself records them
+            if (indices[k] >= n) roster.unresolved[names[indices[k]]].push_back(id);
+        }
+        return Span<string_view>(first, listed_end - first);
+    };
+
+    roster.students.assign(n, Student());
+    roster.unresolved.clear();
+    for (uint32_t id = 0; id < n; ++id) {
+        Student& s = roster.students[id];
+        s.username = names[id];
+        s.programming_skill = skills[id];
+        s.debugging_skill = skills[size_t(n) + id];
+        s.algorithm_skill = skills[2 * size_t(n) + id];
+        s.want_to_work_with = nameList(listed_want_offsets, listed_wants, id);
+        s.dont_want_to_work_with = nameList(listed_conflict_offsets, listed_conflicts, id);
+    }
+    // The adjacency is copied once, out of the mapping and into the arena the roster's lists view
+    auto place = [&](const uint32_t* section, size_t count) {
+        uint32_t* block = roster.arena.allocateArray<uint32_t>(count);
+        copy(section, section + count, block);
+        return block;
+    };
+    roster.want_offsets = place(want_offsets, size_t(n) + 1);
+    roster.want_ids = place(want_ids, header.want_edges);
+    roster.conflict_offsets = place(conflict_offsets, size_t(n) + 1);
+    roster.conflict_ids = place(conflict_ids, header.conflict_edges);
+
+    errors.clear();
+    for (uint32_t e = 0; e < header.errors; ++e) {
+        errors.push_back({static_cast<size_t>(error_lines[e]),
+                          string(error_chars + error_offsets[e], error_offsets[e + 1] - error_offsets[e])});
+    }
+    return true;
+}
+
+RosterLoad loadRoster(const string& filename, unsigned threads, const SnapshotOptions& options) {
+    RosterLoad load;
+    MappedFile file(filename);
+    if (!file.opened()) {
+        return load;
+    }
+    load.opened = true;
+
+    string directory = options.enabled ? snapshotDirectory(options) : string();
+    string path;
+    uint64_t hash = 0;
+    if (!directory.empty()) {
+        hash = hashBytes(file.data());
+        char key[32];
+        snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+        path = directory + "/" + key + ".roster";
+
+        ResolvedRoster resolved;
+        if (readRosterSnapshot(path, hash, file.data().size(), resolved, load.errors)) {
+            load.from_snapshot = true;
+            load.students = resolved.students.size();
+            if (load.students > 0) {
+                load.roster = make_shared<const Roster>(move(resolved));
+            }
+            return load;
+        }
+    }
+
+    file.adviseSequential();
+    ParseResult parsed = parseRosterBuffer(file.data(), threads);
+    load.errors = move(parsed.errors);
+    load.students = parsed.students.size();
+    if (load.students > 0) {
+        load.roster = make_shared<const Roster>(move(parsed.students), move(parsed.arena));
+        if (!path.empty() && makeDirectories(directory)) {
+            writeRosterSnapshot(path, *load.roster, load.errors, hash, file.data().size());
+        }
+    }
+    return load;
+}
@@ -0,0 +1,50 @@
+#ifndef ROSTERSNAPSHOT_HPP
+#define ROSTERSNAPSHOT_HPP
+
+#include "Roster.hpp"
+#include "RosterParser.hpp"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// Binary roster snapshots. A snapshot stores a parsed and resolved roster: the name table,
+// skill columns, each student's listed names as name-table indices, the resolved want and
+// conflict adjacency in CSR form (one offsets array and one flat ID array per relation), and
+// the rows the parser skipped. Every section is a flat array aligned to 8 bytes, so a snapshot
+// is read out of a memory map with bounds checks and no text parsing or name resolution: the
+// name table and each adjacency array are copied once into the roster's arena and used there.
+// The username index (one hash-map node per student), wanted-by lists and conflict matrix are
+// still rebuilt on load. Snapshots are keyed by a hash of the CSV's bytes and are rebuilt
+// whenever it changes.
+const uint32_t kSnapshotVersion = 1;
+
+// Off unless asked for, since it writes a file per roster outside the working directory
+struct SnapshotOptions {
+    bool enabled = false;
+    // Empty uses $TEAMBUILDER_CACHE, then $XDG_CACHE_HOME/teambuilder, then $HOME/.cache/teambuilder
+    std::string directory;
+};
+
+// Writes atomically (temporary file, then rename), so concurrent readers never see a partial snapshot
+bool writeRosterSnapshot(const std::string& path, const Roster& roster, const std::vector<ParseError>& errors,
+                         uint64_t source_hash, uint64_t source_size);
+// False if the file is missing, from another version or source, or fails its checksum or bounds checks
+bool readRosterSnapshot(const std::string& path, uint64_t source_hash, uint64_t source_size, ResolvedRoster& roster,
+                        std::vector<ParseError>& errors);
+
+struct RosterLoad {
+    bool opened = false;
+    bool from_snapshot = false;
+    std::shared_ptr<const Roster> roster;  // Null when the file has no valid rows
+    size_t students = 0;
+    std::vector<ParseError> errors;
+};
+
+// Load a roster CSV, reusing the cached snapshot when one was made from identical bytes;
+// otherwise parse it and leave a snapshot behind for next time. Caching failures only cost
+// the reparse.
+RosterLoad loadRoster(const std::string& filename, unsigned threads = 1,
+                      const SnapshotOptions& options = SnapshotOptions());
+
+#endif // ROSTERSNAPSHOT_HPP
@@ -0,0 +1,356 @@
+#include "Server.hpp"
+#include "TeamBuilder.hpp"
+#include "Anytime.hpp"
+#include "WorkQueue.hpp"
+#include "Utilities.hpp"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Set by SIGINT and SIGTERM; the accept loop polls it between connections
+volatile sig_atomic_t stop_requested = 0;
+
+void requestStop(int) {
+    stop_requested = 1;
+}
+
+// Requests are a few short lines; anything longer is not a request
+const size_t kMaxRequestBytes = 16 * 1024;
+// Limits on request values; a request holds a worker for its whole budget
+const int kMaxRequestTeamSize = 1024;
+const double kMaxRequestBudgetSeconds = 600.0;
+// A client that stalls mid-request or stops reading its reply is dropped after this long
+const int kSocketTimeoutSeconds = 30;
+
+struct ServiceRequest {
+    string roster_file;
+    int team_size = 0;
+    bool prioritize_preferences = true;
+    double budget_seconds = 0.0;
+    TeamFormat format = TeamFormat::Csv;
+    uint64_t seed = 0;
+};
+
+// Read up to the blank line that ends a request, or to the client's shutdown. Lines may end in
+// "\n" or "\r\n"; parseRequest trims the '\r'.
+bool readRequest(int fd, string& text) {
+    char chunk[4096];
+    while (text.size() < kMaxRequestBytes) {
+        ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return received == 0 && !text.empty();
+        text.append(chunk, static_cast<size_t>(received));
+        size_t end = min(text.find("\n\n"), text.find("\r\n\r\n"));
+        if (end != string::npos) {
+            text.resize(end + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseRequest(const string& text, ServiceRequest& request, string& error) {
+    string_view rest = text;
+    while (!rest.empty()) {
+        size_t newline = rest.find('\n');
+        string_view line = trimView(rest.substr(0, newline));
+        rest = newline == string_view::npos ? string_view() : rest.substr(newline + 1);
+        if (line.empty()) continue;
+
+        size_t equals = line.find('=');
+        if (equals == string_view::npos) {
+            error = "expected key=value, got " + string(line);
+            return false;
+        }
+        string_view key = trimView(line.substr(0, equals));
+        string value(trimView(line.substr(equals + 1)));
+        if (key == "roster") {
+            request.roster_file = value;
+        } else if (key == "team_size") {
+            if (!parseNumber(value, request.team_size) || request.team_size > kMaxRequestTeamSize) {
+                error = "team_size must be a whole number from 2 to " + to_string(kMaxRequestTeamSize);
+                return false;
+            }
+        } else if (key == "mode") {
+            if (value != "preferences" && value != "skills") {
+                error = "mode must be preferences or skills";
+                return false;
+            }
+            request.prioritize_preferences = value == "preferences";
+        } else if (key == "budget") {
+            if (!parseNumber(value, request.budget_seconds) || request.budget_seconds > kMaxRequestBudgetSeconds) {
+                error = "budget must be a number of seconds from 0 to " + to_string(int(kMaxRequestBudgetSeconds));
+                return false;
+            }
+        } else if (key == "format") {
+            if (!teamFormatFromName(value, request.format)) {
+                error = "format must be csv, scores, json or binary";
+                return false;
+            }
+        } else if (key == "seed") {
+            if (!parseNumber(value, request.seed)) {
+                error = "seed must be a non-negative whole number";
+                return false;
+            }
+        } else {
+            error = "unknown key " + string(key);
+            return false;
+        }
+    }
+    if (request.roster_file.empty()) {
+        error = "roster is required";
+        return false;
+    }
+    if (request.team_size < 2) {
+        error = "team_size must be a whole number from 2 to " + to_string(kMaxRequestTeamSize);
+        return false;
+    }
+    return true;
+}
+
+// With a roster directory, a request names a file inside it: the path is resolved through any
+// symlinks and ".." and refused unless it lands under the directory, which is already canonical
+bool resolveRosterPath(const string& requested, const string& directory, string& path, string& error) {
+    if (directory.empty()) {
+        path = requested;
+        return true;
+    }
+    char resolved[PATH_MAX];
+    string joined = requested[0] == '/' ? requested : directory + "/" + requested;
+    if (realpath(joined.c_str(), resolved) == nullptr) {
+        error = "cannot open roster " + requested + ": " + strerror(errno);
+        return false;
+    }
+    path = resolved;
+    if (path.compare(0, directory.size() + 1, directory + "/") != 0) {
+        error = "roster " + requested + " is outside the roster directory";
+        return false;
+    }
+    return true;
+}
+
+void serveConnection(int fd, RosterCache& cache, const ServerOptions& options) {
+    auto start = chrono::steady_clock::now();
+    OutputBuffer out;
+    out.attach(fd);
+    auto reject = [&](const string& message) {
+        out.append("ERROR ");
+        out.append(message);
+        out.append('\n');
+    };
+
+    string text;
+    ServiceRequest request;
+    string error;
+    string roster_path;
+    RosterCache::Entry entry;
+    bool hit = false;
+    if (!readRequest(fd, text)) {
+        reject("incomplete request");
+    } else if (!parseRequest(text, request, error)) {
+        reject(error);
+    } else if (!resolveRosterPath(request.roster_file, options.roster_directory, roster_path, error)) {
+        reject(error);
+    } else if (!cache.get(roster_path, entry, hit, error)) {
+        reject(error);
+    } else {
+        bool prioritize_skills = !request.prioritize_preferences;
+        TeamBuilder builder(entry.roster, request.team_size, prioritize_skills);
+        builder.setVerbose(false);
+        builder.setFormationSeed(request.seed);
+        builder.setDecompositionOptions(options.decomposition_options);
+        FormationStatus status;
+        if (request.budget_seconds > 0) {
+            AnytimeSearch search(entry.roster, request.team_size, prioritize_skills);
+            AnytimeOptions anytime;
+            anytime.time_limit_seconds = request.budget_seconds;
+            anytime.seed = request.seed + 1;
+            search.start(request.prioritize_preferences, anytime);
+            AnytimeResult best = search.wait();
+            builder.setTeams(best.teams, best.unassigned);
+            status = best.status;
+        } else {
+            status = builder.formTeams(request.prioritize_preferences);
+        }
+
+        if (status == FormationStatus::Infeasible) {
+            reject("no valid team assignment exists for this roster");
+        } else {
+            AssignmentMetrics metrics =
+                entry.evaluator->evaluate(encodeAssignment(builder.teamMembers(), entry.roster->size()));
+            double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            out.append(status == FormationStatus::Success ? "OK status=success" : "OK status=budget_exhausted");
+            out.append(" teams=");
+            out.appendNumber(static_cast<long long>(builder.teamCount()));
+            out.append(" unassigned=");
+            out.appendNumber(static_cast<long long>(builder.unassignedStudents().size()));
+            out.append(" satisfied=");
+            out.appendNumber(metrics.satisfied_preferences);
+            out.append(" violations=");
+            out.appendNumber(metrics.conflict_violations);
+            out.append(hit ? " cache=hit" : " cache=miss");
+            out.append(" elapsed_ms=");
+            out.append(to_string(elapsed));
+            out.append('\n');
+            builder.writeTeams(*makeTeamWriter(request.format, *entry.roster, out));
+        }
+    }
+    // A client that hung up early only loses its own reply
+    out.finish();
+    close(fd);
+}
+
+int openListener(const string& path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path is too long: " << path << endl;
+        return -1;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        cerr << "Cannot create socket: " << strerror(errno) << endl;
+        return -1;
+    }
+    // A socket file left by a server that did not shut down cleanly would block the bind
+    struct stat existing;
+    if (stat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        unlink(path.c_str());
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+RosterCache::RosterCache(size_t capacity, const SnapshotOptions& snapshot_options)
+    : capacity(max<size_t>(capacity, 1)), snapshot_options(snapshot_options) {
+}
+
+bool RosterCache::get(const string& path, Entry& entry, bool& hit, string& error) {
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0) {
+        error = "cannot open roster " + path + ": " + strerror(errno);
+        return false;
+    }
+    {
+        lock_guard<mutex> lock(slots_mutex);
+        auto found = index.find(path);
+        if (found != index.end()) {
+            Slot& slot = *found->second;
+            if (slot.size == status.st_size && slot.modified.tv_sec == status.st_mtim.tv_sec &&
+                slot.modified.tv_nsec == status.st_mtim.tv_nsec) {
+                slots.splice(slots.begin(), slots, found->second);
+                entry = slot.entry;
+                hit = true;
+                return true;
+            }
+            slots.erase(found->second);
+            index.erase(found);
+        }
+    }
+
+    hit = false;
+    RosterLoad load = loadRoster(path, 1, snapshot_options);
+    if (!load.roster) {
+        error = load.opened ? "no students in " + path : "cannot open roster " + path;
+        return false;
+    }
+    entry.roster = load.roster;
+    entry.evaluator = make_shared<const AssignmentEvaluator>(*load.roster);
+
+    lock_guard<mutex> lock(slots_mutex);
+    // Another request may have loaded the same file meanwhile; the newer load replaces it
+    auto found = index.find(path);
+    if (found != index.end()) {
+        slots.erase(found->second);
+        index.erase(found);
+    }
+    slots.push_front({path, status.st_size, status.st_mtim, entry});
+    index[path] = slots.begin();
+    while (slots.size() > capacity) {
+        index.erase(slots.back().path);
+        slots.pop_back();
+    }
+    return true;
+}
+
+int runServer(const ServerOptions& requested_options) {
+    ServerOptions options = requested_options;
+    if (!options.roster_directory.empty()) {
+        char resolved[PATH_MAX];
+        if (realpath(options.roster_directory.c_str(), resolved) == nullptr) {
+            cerr << "Cannot use roster directory " << options.roster_directory << ": " << strerror(errno) << endl;
+            return 1;
+        }
+        options.roster_directory = resolved;
+    }
+    int listener = openListener(options.socket_path);
+    if (listener < 0) return 1;
+
+    // Replies to clients that hung up fail with EPIPE instead of killing the server
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    unsigned threads = options.threads == 0 ? max(1u, thread::hardware_concurrency()) : options.threads;
+    RosterCache cache(options.cached_rosters, options.snapshot_options);
+    WorkQueue<int> connections(threads * 4);
+    vector<thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([&]() {
+            int fd;
+            while (connections.pop(fd)) {
+                serveConnection(fd, cache, options);
+            }
+        });
+    }
+    cerr << "Serving on " << options.socket_path << " with " << threads << " worker(s)." << endl;
+
+    while (!stop_requested) {
+        pollfd waiting = {listener, POLLIN, 0};
+        if (poll(&waiting, 1, 250) <= 0) continue;
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        timeval timeout = {kSocketTimeoutSeconds, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        connections.push(fd);
+    }
+
+    // Requests already accepted are answered before the server exits
+    connections.close();
+    for (auto& t : workers) {
+        t.join();
+    }
+    close(listener);
+    unlink(options.socket_path.c_str());
+    cerr << "Server stopped." << endl;
+    return 0;
+}
@@ -0,0 +1,80 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include "Roster.hpp"
+#include "Evaluator.hpp"
+#include "RosterSnapshot.hpp"
+#include "Decomposition.hpp"
+#include "TeamWriter.hpp"
+#include <string>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <ctime>
+
+// Service mode: a long-running process that forms teams for requests arriving on a Unix
+// domain socket, so callers skip process startup and, for rosters it has seen, the parse.
+//
+// Trust model: the server reads rosters with its own permissions, and anyone who can connect
+// to the socket can ask for teams from any roster it may read. The socket file gets the
+// server's umask, so keep it in a directory only trusted users can reach. Setting
+// roster_directory (--roster-dir) confines requests to rosters under that directory.
+//
+// One request per connection. The client sends "key=value" lines ending in "\n" or "\r\n"
+// and ends the request with a blank line or by shutting down its side of the socket:
+//   roster=PATH             required; relative to roster_directory when one is set (and must
+//                           stay inside it), otherwise to the server's working directory
+//   team_size=N             required, 2 to 1024
+//   mode=preferences|skills default preferences
+//   budget=SECONDS          with a budget (at most 600), the best teams an anytime search finds by then
+//   format=csv|scores|json|binary   default csv
+//   seed=N                  formation seed, default 0 (roster order)
+// A value that is not a whole number (a number, for budget) in range fails the request.
+// The reply is one status line, then the teams in the requested format until the server closes
+// the connection:
+//   OK status=success|budget_exhausted teams=N unassigned=N satisfied=N violations=N cache=hit|miss elapsed_ms=X
+//   ERROR message
+struct ServerOptions {
+    std::string socket_path;
+    unsigned threads = 0;           // Request workers; 0 uses every available core
+    size_t cached_rosters = 8;      // Rosters kept warm, least recently used evicted first
+    std::string roster_directory;   // If set, requests may only read rosters inside it
+    SnapshotOptions snapshot_options;
+    DecompositionOptions decomposition_options;
+};
+
+// Parsed rosters, with the evaluator built over each, keyed by path. An entry is reused
+// while the file's size and modification time are unchanged, and reloaded otherwise.
+class RosterCache {
+public:
+    struct Entry {
+        std::shared_ptr<const Roster> roster;
+        std::shared_ptr<const AssignmentEvaluator> evaluator;
+    };
+
+    RosterCache(size_t capacity, const SnapshotOptions& snapshot_options);
+
+    // False if the file cannot be read or holds no students, with the reason in `error`.
+    // A miss loads without holding the lock, so other rosters are served meanwhile.
+    bool get(const std::string& path, Entry& entry, bool& hit, std::string& error);
+
+private:
+    struct Slot {
+        std::string path;
+        off_t size;
+        timespec modified;
+        Entry entry;
+    };
+
+    size_t capacity;
+    SnapshotOptions snapshot_options;
+    std::mutex slots_mutex;
+    std::list<Slot> slots;  // Most recently used first
+    std::unordered_map<std::string, std::list<Slot>::iterator> index;
+};
+
+// Serve until SIGINT or SIGTERM; returns the process exit code
+int runServer(const ServerOptions& options);
+
+#endif // SERVER_HPP
@@ -1,18 +1,43 @@
 #ifndef STUDENT_HPP
 #define STUDENT_HPP
 
-#include <vector>
-#include <string>
+#include <string_view>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
 
-// Define the Student struct to store student data
+// Read-only view of `size()` contiguous elements stored elsewhere, usually a roster's arena
+template <typename T>
+class Span {
+public:
+    Span() = default;
+    Span(const T* data, size_t count) : first(data), count(static_cast<uint32_t>(count)) {}
+
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+    const T* data() const { return first; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t index) const { return first[index]; }
+
+private:
+    const T* first = nullptr;
+    uint32_t count = 0;
+};
+
+// Define the Student struct to store student data. A Student only views its username and
+// name lists; the bytes belong to the Roster's (or the parser's) arena, so records copy as
+// plain memory and a whole roster's strings are freed at once.
 struct Student {
-    std::string username;
-    int programming_skill;
-    int debugging_skill;
-    int algorithm_skill;
-    std::vector<std::string> dont_want_to_work_with;
-    std::vector<std::string> want_to_work_with;
+    std::string_view username;
+    int programming_skill = 0;
+    int debugging_skill = 0;
+    int algorithm_skill = 0;
+    Span<std::string_view> dont_want_to_work_with;
+    Span<std::string_view> want_to_work_with;
+    uint32_t id = 0; // Dense roster ID, assigned when the Roster interns the student
 };
 
-#endif // STUDENT_HPP
+static_assert(std::is_trivially_copyable<Student>::value, "Student must stay a plain record of views");
 
+#endif // STUDENT_HPP
@@ -1,14 +1,31 @@
 #include "TeamBuilder.hpp"
+#include "Instrumentation.hpp"
+#include "MutualPreferences.hpp"
 #include <iostream>
-#include <fstream>
 #include <algorithm>
 #include <iterator>
 #include <functional>
 #include <cmath>
 #include <numeric>
+#include <chrono>
+#include <cstdint>
+#include <climits>
+#include <queue>
+#include <tuple>
+#include <thread>
+#include <atomic>
 
 using namespace std;
 
+// Neediest open teams compared per student when balancing skills
+const size_t kBalanceCandidates = 16;
+
+// Smallest subproblem worth its own group when forming by components
+const size_t kMinGroupStudents = 512;
+
+// Output buffers are sized to hold the whole output up to this, and reused past it
+const size_t kMaxOutputBuffer = 4 * 1024 * 1024;
+
 // Definition of the vectorEquals function
 bool vectorEquals(const vector<Student>& a, const vector<Student>& b) {
     if (a.size() != b.size())
@@ -24,348 +41,1285 @@ bool vectorEquals(const vector<Student>& a, const vector<Student>& b) {
 
 // Constructor for TeamBuilder
 TeamBuilder::TeamBuilder(const vector<Student>& students, int team_size, bool prioritize_skills)
-    : students(students), team_size(team_size), prioritize_skills(prioritize_skills) {
-    loadStudentMap();
+    : TeamBuilder(nullptr, team_size, prioritize_skills) {
+    adoptRoster(std::make_shared<Roster>(students));
 }
 
-// Load student data into a map for quick lookups
-void TeamBuilder::loadStudentMap() {
-    for (const auto& student : students) {
-        student_map[student.username] = student;
+TeamBuilder::TeamBuilder(shared_ptr<const Roster> roster, int team_size, bool prioritize_skills)
+    : shared_roster(roster), roster(shared_roster.get()), team_size(team_size), prioritize_skills(prioritize_skills) {
+}
+
+// Take sole ownership of a roster, which incremental changes may then edit in place
+void TeamBuilder::adoptRoster(shared_ptr<Roster> owned) {
+    owned_roster = move(owned);
+    shared_roster = owned_roster;
+    roster = owned_roster.get();
+}
+
+// Copy-on-write: a roster shared with other builders is cloned before the first edit
+Roster& TeamBuilder::mutableRoster() {
+    if (!owned_roster) {
+        adoptRoster(std::make_shared<Roster>(*roster));
+    }
+    return *owned_roster;
+}
+
+// Seeded Fisher-Yates shuffle of the candidate order
+void TeamBuilder::shuffleOrder(vector<uint32_t>& order) const {
+    if (formation_seed == 0) return;
+    Random random(formation_seed);
+    for (size_t i = order.size(); i > 1; --i) {
+        swap(order[i - 1], order[random.below(static_cast<uint32_t>(i))]);
+    }
+}
+
+// Adopt an assignment formed elsewhere and score it
+void TeamBuilder::setTeams(const vector<vector<uint32_t>>& members, const vector<uint32_t>& unassigned) {
+    resetTeams(members.size());
+    for (size_t i = 0; i < members.size(); ++i) {
+        for (uint32_t id : members[i]) {
+            addToTeam(i, id);
+        }
+    }
+    unassigned_students = unassigned;
+    calculateTeamScores();
+}
+
+// Clear all teams and their forbidden sets, and spread the students evenly over the team targets
+void TeamBuilder::resetTeams(size_t num_teams) {
+    teams.resize(num_teams);
+    team_forbidden.assign(num_teams, ForbiddenSet());
+    team_targets.assign(num_teams, 0);
+    unassigned_students.clear();
+    for (size_t i = 0; i < num_teams; ++i) {
+        team_targets[i] = roster->size() / num_teams + (i < roster->size() % num_teams ? 1 : 0);
+        // Keep each team's buffer so repeated formations don't reallocate
+        teams[i].clear();
+        teams[i].reserve(team_targets[i]);
+    }
+}
+
+// Add a student to a team and fold their conflicts into the team's forbidden set
+void TeamBuilder::addToTeam(size_t team_index, uint32_t id) {
+    teams[team_index].push_back(id);
+    team_forbidden[team_index].add(*roster, id);
+}
+
+// Remove a student from a team; the forbidden set is only rebuilt if they contributed to it
+void TeamBuilder::removeFromTeam(size_t team_index, uint32_t id) {
+    vector<uint32_t>& team = teams[team_index];
+    team.erase(find(team.begin(), team.end(), id));
+    if (!roster->conflicts(id).empty()) {
+        rebuildForbidden(team_index);
+    }
+}
+
+// Recompute a team's forbidden set from its current members
+void TeamBuilder::rebuildForbidden(size_t team_index) {
+    team_forbidden[team_index].clear();
+    for (uint32_t member : teams[team_index]) {
+        team_forbidden[team_index].add(*roster, member);
     }
 }
 
 // Check if new member can work with existing team members
-bool TeamBuilder::canWorkTogether(const vector<Student>& team, const Student& new_member) {
-    for (const auto& member : team) {
-        if (find(member.dont_want_to_work_with.begin(), member.dont_want_to_work_with.end(), new_member.username) != member.dont_want_to_work_with.end()) {
-            return false;
+bool TeamBuilder::canWorkTogether(size_t team_index, uint32_t id) const {
+    bool compatible = !team_forbidden[team_index].contains(id);
+    STATS_COUNT(CompatibilityChecks, 1);
+    STATS_COUNT(CompatibilityRejects, compatible ? 0 : 1);
+    return compatible;
+}
+
+// Approximate heap footprint of the team structures
+size_t TeamBuilder::teamBytes() const {
+    size_t bytes = teams.capacity() * sizeof(teams[0]) + team_forbidden.capacity() * sizeof(ForbiddenSet);
+    for (size_t i = 0; i < teams.size(); ++i) {
+        bytes += teams[i].capacity() * sizeof(uint32_t) + team_forbidden[i].bytes();
+    }
+    return bytes;
+}
+
+// Form teams based on either preferences or skills
+FormationStatus TeamBuilder::formTeams(bool prioritize_preferences) {
+    FormationStatus status = FormationStatus::Success;
+    bool exact = false;
+    {
+        STATS_TIMER(Formation);
+        if (prioritize_preferences) {
+            status = decomposition_options.enabled ? formTeamsByComponents() : formTeamsByPreferences();
+        } else {
+            status = formTeamsBySkills();
         }
-        if (find(new_member.dont_want_to_work_with.begin(), new_member.dont_want_to_work_with.end(), member.username) != new_member.dont_want_to_work_with.end()) {
-            return false;
+        if (exact_options.enabled && formTeamsExactly()) {
+            exact = true;
+            status = FormationStatus::Success;
+        }
+    }
+    STATS_PEAK(TeamBytes, teamBytes());
+    // An exact assignment is already optimal for preferences; annealing would only trade that away
+    if (optimizer_options.enabled && !exact) {
+        improveTeams();
+    }
+    if (verbose && !prioritize_preferences) {
+        array<int, 3> spread = skillSpread();
+        cout << "Skill spread (max - min): programming " << spread[0] << ", debugging " << spread[1]
+             << ", algorithm " << spread[2] << endl;
+        if (!hasSkillMinimum(team_size)) {
+            cout << "The rubric sets no minimum scores for teams of " << team_size << "; scores are not adjusted." << endl;
+        }
+    }
+    calculateTeamScores();
+    return status;
+}
+
+// Replace the heuristic teams with the exact search's best assignment. The heuristic result seeds
+// the search's incumbent; it is kept if the search finds nothing that meets the constraints.
+bool TeamBuilder::formTeamsExactly() {
+    exact_result = ExactResult();
+    if (roster->size() > kExactStudentLimit) {
+        if (verbose) {
+            cerr << "Exact mode handles at most " << kExactStudentLimit << " students; keeping the heuristic teams." << endl;
         }
+        return false;
+    }
+
+    ExactSolver solver(*roster, team_targets);
+    if (unassigned_students.empty()) {
+        solver.setIncumbent(teams);
+    }
+    exact_result = solver.solve(exact_options.time_limit_seconds);
+    if (verbose) {
+        if (!exact_result.found) {
+            cout << (exact_result.proven_optimal ? "Exact search: no assignment meets the conflict and skill constraints"
+                                                 : "Exact search: time budget ran out before a valid assignment was found")
+                 << "; keeping the heuristic teams." << endl;
+        } else if (exact_result.proven_optimal) {
+            cout << "Exact search: " << exact_result.satisfied << " satisfied preference(s), proven optimal ("
+                 << exact_result.nodes << " nodes)." << endl;
+        } else {
+            cout << "Exact search: " << exact_result.satisfied << " satisfied preference(s) when the time budget ran out; "
+                 << "upper bound " << exact_result.upper_bound << ", gap " << exact_result.gap() << "." << endl;
+        }
+    }
+    if (!exact_result.found) {
+        return false;
+    }
+
+    // Hand each solved team to a slot with the same target size
+    vector<vector<uint32_t>> solved = exact_result.teams;
+    resetTeams(teams.size());
+    for (size_t team_index = 0; team_index < teams.size(); ++team_index) {
+        auto match = find_if(solved.begin(), solved.end(), [&](const vector<uint32_t>& members) {
+            return members.size() == team_targets[team_index];
+        });
+        for (uint32_t id : *match) {
+            addToTeam(team_index, id);
+        }
+        solved.erase(match);
     }
     return true;
 }
 
-// Form teams based on either preferences or skills
-void TeamBuilder::formTeams(bool prioritize_preferences) {
-    if (prioritize_preferences) {
-        formTeamsByPreferences();
-    } else {
-        formTeamsBySkills();
+// Run the local-search optimizer over the formed teams
+void TeamBuilder::improveTeams() {
+    STATS_TIMER(Optimize);
+    LocalSearchOptimizer optimizer(*roster, optimizer_options);
+    optimizer.optimize(teams);
+    if (verbose) {
+        cout << "Optimizer: " << optimizer.satisfiedPreferences() << " satisfied preference(s), skill variance "
+             << optimizer.skillVariance() << endl;
+    }
+
+    for (size_t i = 0; i < teams.size(); ++i) {
+        rebuildForbidden(i);
     }
-    calculateTeamScores();
 }
 
 // Form teams prioritizing preferences
-void TeamBuilder::formTeamsByPreferences() {
-    set<string> assigned_students;
-    vector<Student> remaining_students = students;
-    vector<Student> team_leaders;
-    size_t leader_index = 0;
+FormationStatus TeamBuilder::formTeamsByPreferences() {
+    uint32_t num_students = roster->size();
+    vector<uint32_t> order(num_students);
+    iota(order.begin(), order.end(), 0);
+    shuffleOrder(order);
+    CandidatePool pool(*roster, order);
 
     // Calculate the number of teams needed
-    int num_teams = ceil(static_cast<double>(students.size()) / team_size);
-    teams.resize(num_teams);
+    int num_teams = ceil(static_cast<double>(num_students) / team_size);
+    resetTeams(num_teams);
 
     // Debug: count students with preferences
     int students_with_preferences = 0;
-    for (const auto& student : students) {
-        if (!student.want_to_work_with.empty()) {
+    for (uint32_t id = 0; id < num_students; ++id) {
+        if (!roster->student(id).want_to_work_with.empty()) {
             students_with_preferences++;
         }
     }
-    cout << "Total students with preferences: " << students_with_preferences << endl;
+    if (verbose) {
+        cout << "Total students with preferences: " << students_with_preferences << endl;
+    }
+
+    fillTeamsByPreferences(pool, 0, teams.size(), verbose);
+
+    // Distribute any remaining students evenly among teams
+    distributeRemainingStudents(pool, 0, teams.size());
+
+    vector<uint32_t> leftover = pool.remaining();
+    return repairTeams(leftover);
+}
 
+// Greedy preference pass over teams [first_team, last_team), drawing students from the pool.
+// Groups of students who all listed each other seed the first teams whole; the rest are led by
+// the student with the most wanted teammates still unplaced.
+void TeamBuilder::fillTeamsByPreferences(CandidatePool& pool, size_t first_team, size_t last_team, bool trace) {
     // Helper function to assign a student to a team
-    auto assignStudentToTeam = [&](Student& student, vector<Student>& team) {
-        team.push_back(student);
-        assigned_students.insert(student.username);
-        remaining_students.erase(remove_if(remaining_students.begin(), remaining_students.end(), [&](const Student& s) {
-            return s.username == student.username;
-        }), remaining_students.end());
+    auto assignStudentToTeam = [&](uint32_t id, size_t team_index) {
+        addToTeam(team_index, id);
+        pool.remove(id);
     };
 
     // Try to add a preferred student to a team
-    auto tryToAddPreferredStudent = [&](const Student& preferrer, vector<Student>& team) -> bool {
-        for (const auto& pref : preferrer.want_to_work_with) {
-            if (assigned_students.find(pref) == assigned_students.end() && student_map.find(pref) != student_map.end()) {
-                Student preferred_student = student_map[pref];
-                if (canWorkTogether(team, preferred_student)) {
-                    assignStudentToTeam(preferred_student, team);
-                    return true;
-                }
+    auto tryToAddPreferredStudent = [&](uint32_t preferrer, size_t team_index) -> bool {
+        if (teams[team_index].size() >= team_targets[team_index]) return false;
+        for (uint32_t pref : roster->wants(preferrer)) {
+            if (pool.contains(pref) && canWorkTogether(team_index, pref)) {
+                assignStudentToTeam(pref, team_index);
+                return true;
             }
         }
         return false;
     };
 
     // Fill the team with random students if needed
-    auto fillTeamWithRandomStudents = [&](vector<Student>& team) {
-        while (team.size() < static_cast<size_t>(team_size) && !remaining_students.empty()) {
-            auto random_it = remaining_students.begin();
-            while (random_it != remaining_students.end() && !canWorkTogether(team, *random_it)) {
-                ++random_it;
-            }
-            if (random_it != remaining_students.end()) {
-                assignStudentToTeam(*random_it, team);
-            } else {
+    auto fillTeamWithRandomStudents = [&](size_t team_index) {
+        while (teams[team_index].size() < team_targets[team_index] && !pool.empty()) {
+            uint32_t id = nextCompatible(pool, team_index);
+            if (id == kNoStudent) {
                 break;
             }
+            assignStudentToTeam(id, team_index);
         }
     };
 
-    // Find a student with preferences
-    auto findStudentWithPreferences = [&]() -> vector<Student>::iterator {
-        return find_if(remaining_students.begin(), remaining_students.end(), [](const Student& s) {
-            return !s.want_to_work_with.empty();
-        });
+    size_t largest_target = 0;
+    for (size_t team_index = first_team; team_index < last_team; ++team_index) {
+        largest_target = max(largest_target, team_targets[team_index]);
+    }
+    vector<vector<uint32_t>> cliques = mutualPreferenceCliques(*roster, pool, largest_target);
+
+    // Place every clique before filling any seeded team, so no fill takes a later clique's member
+    size_t team_index = first_team;
+    for (const auto& clique : cliques) {
+        if (team_index == last_team) break;
+        // Members past a smaller team's target stay in the pool
+        for (uint32_t id : clique) {
+            if (teams[team_index].size() < team_targets[team_index]) {
+                assignStudentToTeam(id, team_index);
+            }
+        }
+        if (trace) {
+            cout << "Assigned " << teams[team_index].size() << " students who all listed each other to a team.\n";
+        }
+        ++team_index;
+    }
+    STATS_COUNT(SeededTeams, team_index - first_team);
+    for (size_t seeded = first_team; seeded < team_index; ++seeded) {
+        for (size_t i = 0; i < teams[seeded].size(); ++i) {
+            tryToAddPreferredStudent(teams[seeded][i], seeded);
+        }
+        fillTeamWithRandomStudents(seeded);
+    }
+
+    // Leaders come off a max-heap keyed on wanted teammates still in the pool, ties in pool order.
+    // Keys only fall as students are placed, so a stale entry is re-keyed when it reaches the top.
+    using Leader = tuple<uint32_t, uint32_t, uint32_t>;  // (wanted in pool, ~rank, ID)
+    auto wantedInPool = [&](uint32_t id) {
+        uint32_t wanted = 0;
+        for (uint32_t other : roster->wants(id)) {
+            wanted += pool.contains(other) ? 1 : 0;
+        }
+        return wanted;
+    };
+    vector<Leader> heap;
+    heap.reserve(pool.size());
+    uint32_t rank = 0;
+    for (uint32_t id = pool.frontWithPreferences(); id != kNoStudent; id = pool.nextWithPreferences(id)) {
+        uint32_t wanted = wantedInPool(id);
+        if (wanted > 0) heap.emplace_back(wanted, ~rank, id);
+        ++rank;
+    }
+    priority_queue<Leader> leaders(less<Leader>(), move(heap));
+    auto nextLeader = [&]() {
+        while (!leaders.empty()) {
+            Leader top = leaders.top();
+            uint32_t id = get<2>(top);
+            if (!pool.contains(id)) {
+                leaders.pop();
+                continue;
+            }
+            uint32_t wanted = wantedInPool(id);
+            if (wanted == get<0>(top)) return id;
+            leaders.pop();
+            if (wanted > 0) leaders.emplace(wanted, get<1>(top), id);
+        }
+        // Nobody left can still be placed with a wanted teammate
+        return pool.front();
     };
 
-    // Form teams iteratively until successful
-    bool successful_formation = false;
-    while (!successful_formation) {
-        assigned_students.clear();
-        remaining_students = students;
-        for (auto& team : teams) {
-            team.clear();
-        }
-
-        // Keep track of already selected team leaders in this formation attempt
-        set<string> used_team_leaders;
-
-        for (auto& team : teams) {
-            if (remaining_students.empty()) break;
-
-            // Select team leader
-            Student student1;
-            bool leader_selected = false;
-
-            while (!leader_selected) {
-                if (!team_leaders.empty() && leader_index < team_leaders.size()) {
-                    student1 = team_leaders[leader_index];
-                    leader_index++;
-                } else {
-                    auto it = findStudentWithPreferences();
-                    if (it == remaining_students.end()) {
-                        it = remaining_students.begin();
-                    }
-                    student1 = *it;
-                    team_leaders.push_back(student1);
-                    leader_index = 1; // Reset leader_index to start rotating through new leaders on next restart
-                }
+    // Single greedy pass; teams it cannot complete are handed to the backtracking repair below
+    for (; team_index < last_team; ++team_index) {
+        if (pool.empty()) break;
+
+        // Select team leader, preferring a student with preferences
+        uint32_t student1 = nextLeader();
+        assignStudentToTeam(student1, team_index);
 
-                if (used_team_leaders.find(student1.username) == used_team_leaders.end()) {
-                    leader_selected = true;
-                    used_team_leaders.insert(student1.username);
+        // Debug: output the student assigned
+        if (trace) {
+            cout << "Assigned student " << roster->student(student1).username << " to a team.\n";
+        }
+
+        // Try to assign preferred teammates
+        if (!tryToAddPreferredStudent(student1, team_index)) {
+            // If no preferred teammates can be assigned, fill with random students
+            fillTeamWithRandomStudents(team_index);
+        } else {
+            // If a preferred teammate was assigned, try to assign their preferred teammates
+            if (teams[team_index].size() < team_targets[team_index]) {
+                uint32_t student2 = teams[team_index].back();
+                if (!tryToAddPreferredStudent(student2, team_index)) {
+                    // If no preferred teammates can be assigned, fill with another preference of student1 or random students
+                    tryToAddPreferredStudent(student1, team_index);
                 }
             }
+            fillTeamWithRandomStudents(team_index);
+        }
+    }
+}
 
-            assignStudentToTeam(student1, team);
-
-            // Debug: output the student assigned
-            cout << "Assigned student " << student1.username << " to a team." << endl;
-
-            // Try to assign preferred teammates
-            if (!tryToAddPreferredStudent(student1, team)) {
-                // If no preferred teammates can be assigned, fill with random students
-                fillTeamWithRandomStudents(team);
-            } else {
-                // If a preferred teammate was assigned, try to assign their preferred teammates
-                if (team.size() < static_cast<size_t>(team_size)) {
-                    Student student2 = team.back();
-                    if (!tryToAddPreferredStudent(student2, team)) {
-                        // If no preferred teammates can be assigned, fill with another preference of student1 or random students
-                        tryToAddPreferredStudent(student1, team);
-                        fillTeamWithRandomStudents(team);
-                    }
-                }
+// Form teams by preferences one connected component at a time. Components are packed into
+// groups and each group gets its own run of the balanced team slots, which a worker thread fills
+// with the usual greedy pass over a pool of just that group's students. Groups touch disjoint
+// slots and students, so they need no locking. Students a group could not place and the
+// unconstrained students then fill the remaining room, and repair runs once over the whole roster.
+FormationStatus TeamBuilder::formTeamsByComponents() {
+    unsigned threads = decomposition_options.threads;
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    // With one thread the split is pure overhead
+    if (threads == 1) {
+        return formTeamsByPreferences();
+    }
+
+    vector<uint32_t> unconstrained;
+    vector<vector<uint32_t>> components = connectedComponents(*roster, unconstrained);
+    size_t num_unconstrained = unconstrained.size();
+    // A few groups per thread keeps the workers busy when component sizes are uneven
+    size_t constrained = roster->size() - num_unconstrained;
+    size_t group_size = max(kMinGroupStudents, (constrained + threads * 4 - 1) / (threads * 4));
+    group_size = (group_size + team_size - 1) / team_size * team_size;
+    vector<vector<uint32_t>> groups = groupComponents(components, group_size, team_size, unconstrained);
+    if (verbose) {
+        cout << "Decomposed " << roster->size() << " students into " << components.size() << " component(s) in "
+             << groups.size() << " group(s), with " << num_unconstrained << " unconstrained." << endl;
+    }
+    // One group, or one component holding most students, leaves the same sequential critical path
+    if (groups.size() <= 1 || components[0].size() * 2 > constrained) {
+        return formTeamsByPreferences();
+    }
+
+    int num_teams = ceil(static_cast<double>(roster->size()) / team_size);
+    resetTeams(num_teams);
+
+    // Each group takes consecutive slots up to its own size; a group that finds the slots used up
+    // leaves all its students to the fill below
+    vector<size_t> first_slot(groups.size() + 1);
+    size_t next_slot = 0;
+    for (size_t g = 0; g < groups.size(); ++g) {
+        first_slot[g] = next_slot;
+        size_t capacity = 0;
+        while (next_slot < teams.size() && capacity + team_targets[next_slot] <= groups[g].size()) {
+            capacity += team_targets[next_slot++];
+        }
+    }
+    first_slot[groups.size()] = next_slot;
+
+    // Leftovers land in per-group slots, so the merge below does not depend on thread timing
+    vector<vector<uint32_t>> group_leftover(groups.size());
+    atomic<size_t> next_group(0);
+    auto worker = [&]() {
+        CandidatePool pool(*roster, vector<uint32_t>());
+        vector<uint32_t> order;
+        for (size_t g = next_group.fetch_add(1); g < groups.size(); g = next_group.fetch_add(1)) {
+            order = groups[g];
+            shuffleOrder(order);
+            pool.reset(order);
+            fillTeamsByPreferences(pool, first_slot[g], first_slot[g + 1], false);
+            distributeRemainingStudents(pool, first_slot[g], first_slot[g + 1]);
+            group_leftover[g] = pool.remaining();
+        }
+    };
+    threads = static_cast<unsigned>(min<size_t>(threads, groups.size()));
+    vector<thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : workers) {
+        t.join();
+    }
+
+    vector<uint32_t> rest = move(unconstrained);
+    for (const auto& leftover : group_leftover) {
+        rest.insert(rest.end(), leftover.begin(), leftover.end());
+    }
+    CandidatePool pool(*roster, rest);
+    fillTeamsByPreferences(pool, next_slot, teams.size(), false);
+    distributeRemainingStudents(pool, 0, teams.size());
+    vector<uint32_t> leftover = pool.remaining();
+    return repairTeams(leftover);
+}
+
+// First student left in the pool who has no conflict with the team. Only students in the
+// team's forbidden set are skipped, so the scan is bounded by the team's conflicts.
+uint32_t TeamBuilder::nextCompatible(const CandidatePool& pool, size_t team_index) const {
+    return pool.findFirst([this, team_index](uint32_t id) { return canWorkTogether(team_index, id); });
+}
+
+// Search state shared by the backtracking repair
+struct TeamBuilder::SearchContext {
+    chrono::steady_clock::time_point deadline;
+    uint64_t backtracks = 0;
+    uint64_t max_backtracks = 0;
+    uint64_t nodes = 0;
+    CancellationToken cancellation;
+    bool exhausted = false;
+
+    bool outOfBudget() {
+        if (exhausted) return true;
+        if (backtracks > max_backtracks ||
+            ((++nodes & 1023) == 0 && (chrono::steady_clock::now() > deadline || cancellation.cancelled()))) {
+            exhausted = true;
+        }
+        return exhausted;
+    }
+};
+
+// Repair the teams the greedy pass could not complete. Only those teams are released and re-solved
+// together with the leftover students; if that subproblem is infeasible, the released set is widened
+// until either a solution is found or the whole roster has been searched and proven infeasible.
+FormationStatus TeamBuilder::repairTeams(vector<uint32_t>& leftover) {
+    if (leftover.empty()) {
+        return FormationStatus::Success;
+    }
+
+    vector<char> is_released(teams.size(), 0);
+    vector<size_t> released;
+    for (size_t i = 0; i < teams.size(); ++i) {
+        if (teams[i].size() < team_targets[i]) {
+            is_released[i] = 1;
+            released.push_back(i);
+        }
+    }
+
+    SearchContext context;
+    context.deadline = chrono::steady_clock::now() +
+        chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(solver_budget.time_limit_seconds));
+    context.max_backtracks = solver_budget.max_backtracks;
+    context.cancellation = solver_budget.cancellation;
+
+    while (true) {
+        STATS_COUNT(RepairRounds, 1);
+        if (verbose) {
+            cerr << "Repairing " << released.size() << " incomplete team(s) with " << leftover.size() << " unplaced student(s)." << endl;
+        }
+
+        // Release the chosen teams, remembering their members in case the subproblem fails
+        vector<vector<uint32_t>> saved(released.size());
+        vector<uint32_t> pool = leftover;
+        for (size_t r = 0; r < released.size(); ++r) {
+            saved[r] = teams[released[r]];
+            pool.insert(pool.end(), saved[r].begin(), saved[r].end());
+            teams[released[r]].clear();
+            team_forbidden[released[r]].clear();
+        }
+
+        // Students without conflicts fit anywhere, so only the constrained ones need searching
+        auto unconstrained = partition(pool.begin(), pool.end(), [this](uint32_t id) {
+            return !roster->conflicts(id).empty();
+        });
+        vector<uint32_t> constrained(pool.begin(), unconstrained);
+        vector<uint32_t> free_students(unconstrained, pool.end());
+
+        if (placeConstrained(constrained, 0, released, context)) {
+            placeUnconstrained(free_students, released);
+            leftover.clear();
+            return FormationStatus::Success;
+        }
+
+        // Undo the partial search and put the released teams back as they were
+        for (size_t r = 0; r < released.size(); ++r) {
+            teams[released[r]].clear();
+            team_forbidden[released[r]].clear();
+            for (uint32_t id : saved[r]) {
+                addToTeam(released[r], id);
             }
         }
 
-        // Check if all teams are of the same size
-        successful_formation = true;
-        for (const auto& team : teams) {
-            if (team.size() != static_cast<size_t>(team_size)) {
-                cerr << "Unequal team sizes detected. Restarting team formation." << endl;
-                successful_formation = false;
-                break;
+        if (context.exhausted || released.size() == teams.size()) {
+            unassigned_students = leftover;
+            if (verbose) {
+                cerr << (context.exhausted ? "Solver budget exhausted after " : "No conflict-free assignment exists; searched ")
+                     << context.backtracks << " backtrack(s). " << leftover.size() << " student(s) left unassigned." << endl;
             }
+            return context.exhausted ? FormationStatus::BudgetExhausted : FormationStatus::Infeasible;
         }
 
-        // If the last team has conflicting students, restart the process
-        if (successful_formation) {
-            for (const auto& member1 : teams.back()) {
-                for (const auto& member2 : teams.back()) {
-                    if (find(member1.dont_want_to_work_with.begin(), member1.dont_want_to_work_with.end(), member2.username) != member1.dont_want_to_work_with.end() ||
-                        find(member2.dont_want_to_work_with.begin(), member2.dont_want_to_work_with.end(), member1.username) != member2.dont_want_to_work_with.end()) {
-                        cerr << "Conflicting team members found. Restarting team formation." << endl;
-                        successful_formation = false;
-                        break;
-                    }
-                }
-                if (!successful_formation) break;
+        // Widen the search by doubling the released set
+        size_t grow = released.size();
+        for (size_t i = 0; i < teams.size() && grow > 0; ++i) {
+            if (!is_released[i]) {
+                is_released[i] = 1;
+                released.push_back(i);
+                --grow;
+            }
+        }
+    }
+}
+
+// Depth-first search over the constrained students with most-constrained-first ordering and forward checking
+bool TeamBuilder::placeConstrained(vector<uint32_t>& pool, size_t placed, const vector<size_t>& released, SearchContext& context) {
+    if (placed == pool.size()) {
+        return true;
+    }
+    if (context.outOfBudget()) {
+        return false;
+    }
+
+    // Pick the student with the fewest teams still open to them
+    size_t best = placed;
+    size_t best_options = SIZE_MAX;
+    for (size_t i = placed; i < pool.size() && best_options > 0; ++i) {
+        size_t options = 0;
+        for (size_t team_index : released) {
+            if (teams[team_index].size() < team_targets[team_index] && canWorkTogether(team_index, pool[i])) {
+                ++options;
             }
         }
+        if (options < best_options) {
+            best_options = options;
+            best = i;
+        }
+    }
+    if (best_options == 0) {
+        ++context.backtracks;
+        STATS_COUNT(Backtracks, 1);
+        return false;
+    }
+    swap(pool[placed], pool[best]);
+    uint32_t id = pool[placed];
 
-        // Rotate team leaders if unsuccessful formation
-        if (!successful_formation) {
-            rotate(team_leaders.rbegin(), team_leaders.rbegin() + 1, team_leaders.rend());
-            leader_index = 0;
+    // Try teams holding students this one wants to work with first
+    vector<pair<int, size_t>> candidates;
+    vector<size_t> empty_targets_tried;
+    for (size_t team_index : released) {
+        if (teams[team_index].size() >= team_targets[team_index] || !canWorkTogether(team_index, id)) continue;
+        if (teams[team_index].empty()) {
+            // Empty teams with the same target are interchangeable, so only one of each size needs trying
+            size_t target = team_targets[team_index];
+            if (find(empty_targets_tried.begin(), empty_targets_tried.end(), target) != empty_targets_tried.end()) continue;
+            empty_targets_tried.push_back(target);
+        }
+        int affinity = 0;
+        for (uint32_t want : roster->wants(id)) {
+            affinity += static_cast<int>(count(teams[team_index].begin(), teams[team_index].end(), want));
         }
+        candidates.push_back(make_pair(-affinity, team_index));
     }
+    sort(candidates.begin(), candidates.end());
 
-    // Distribute any remaining students evenly among teams
-    distributeRemainingStudents(remaining_students, assigned_students);
+    for (const auto& candidate : candidates) {
+        addToTeam(candidate.second, id);
+        if (placeConstrained(pool, placed + 1, released, context)) {
+            return true;
+        }
+        removeFromTeam(candidate.second, id);
+        if (context.exhausted) {
+            return false;
+        }
+    }
+    ++context.backtracks;
+    STATS_COUNT(Backtracks, 1);
+    return false;
 }
 
-// Form teams by balancing skills
-void TeamBuilder::formTeamsBySkills() {
-    set<string> assigned_students;
-    vector<Student> remaining_students = students;
+// Fill the remaining room in the released teams, keeping wanted teammates together where possible
+void TeamBuilder::placeUnconstrained(const vector<uint32_t>& pool, const vector<size_t>& released) {
+    StudentBitset placed(roster->size());
+    StudentBitset in_pool(roster->size());
+    for (uint32_t id : pool) {
+        in_pool.set(id);
+    }
+    for (uint32_t id : pool) {
+        if (placed.test(id)) continue;
+        size_t target = released.front();
+        for (size_t team_index : released) {
+            if (teams[team_index].size() < team_targets[team_index]) {
+                target = team_index;
+                break;
+            }
+        }
+        addToTeam(target, id);
+        placed.set(id);
+        for (uint32_t want : roster->wants(id)) {
+            if (teams[target].size() >= team_targets[target]) break;
+            if (in_pool.test(want) && !placed.test(want)) {
+                addToTeam(target, want);
+                placed.set(want);
+            }
+        }
+    }
+}
+
+// Form teams by balancing skills. Students are drafted strongest first (LPT order) into the
+// open team a min-heap ranks as neediest: fewest members, then the largest shortfall below the
+// roster's mean skill summed over all three axes. The few neediest compatible teams are compared
+// on which one's weakest axes this student fills best. Students no open team can take are
+// handed to the backtracking repair.
+FormationStatus TeamBuilder::formTeamsBySkills() {
+    uint32_t num_students = roster->size();
+    vector<uint32_t> order(num_students);
+    iota(order.begin(), order.end(), 0);
 
     // Calculate the number of teams needed
-    int num_teams = ceil(static_cast<double>(students.size()) / team_size);
-    teams.resize(num_teams);
+    int num_teams = ceil(static_cast<double>(num_students) / team_size);
+    resetTeams(num_teams);
 
-    // Sort students based on their total skill level
-    sort(remaining_students.begin(), remaining_students.end(), [](const Student& a, const Student& b) {
-        int total_skill_a = a.programming_skill + a.debugging_skill + a.algorithm_skill;
-        int total_skill_b = b.programming_skill + b.debugging_skill + b.algorithm_skill;
+    // Sort students based on their total skill level; ties keep the (possibly seeded) roster order
+    shuffleOrder(order);
+    stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        const Student& sa = roster->student(a);
+        const Student& sb = roster->student(b);
+        int total_skill_a = sa.programming_skill + sa.debugging_skill + sa.algorithm_skill;
+        int total_skill_b = sb.programming_skill + sb.debugging_skill + sb.algorithm_skill;
         return total_skill_a > total_skill_b;
     });
 
-    // Distribute students among teams to balance skills
-    for (int skill_type = 0; skill_type < 3; ++skill_type) {
-        size_t index = 0;
-        while (!remaining_students.empty()) {
-            for (auto& team : teams) {
-                if (team.size() < static_cast<size_t>(team_size)) {
-                    auto it = remaining_students.begin() + (index % remaining_students.size());
-                    if (assigned_students.find(it->username) == assigned_students.end() && canWorkTogether(team, *it)) {
-                        team.push_back(*it);
-                        assigned_students.insert(it->username);
-                        remaining_students.erase(it);
-                        break;
-                    }
-                }
+    // Team totals are kept as skill sums scaled by the roster size, so a team's shortfall
+    // against the mean (mean * size - total) stays in integers
+    array<long long, 3> column_sums = {{0, 0, 0}};
+    for (uint32_t id = 0; id < num_students; ++id) {
+        for (int k = 0; k < 3; ++k) {
+            column_sums[k] += roster->skill(k, id);
+        }
+    }
+    vector<array<long long, 3>> shortfall(teams.size(), array<long long, 3>{{0, 0, 0}});
+
+    // Min-heap on (members, surplus over the mean, team index)
+    typedef tuple<size_t, long long, size_t> HeapEntry;
+    priority_queue<HeapEntry, vector<HeapEntry>, greater<HeapEntry>> open_teams;
+    auto surplus = [&](size_t team_index) {
+        return -(shortfall[team_index][0] + shortfall[team_index][1] + shortfall[team_index][2]);
+    };
+    for (size_t team_index = 0; team_index < teams.size(); ++team_index) {
+        if (team_targets[team_index] > 0) {
+            open_teams.push(HeapEntry(0, 0, team_index));
+        }
+    }
+
+    vector<uint32_t> leftover;
+    vector<size_t> skipped;
+    vector<size_t> candidates;
+    for (uint32_t id : order) {
+        // Pop the neediest teams this student can join; conflicting ones are set aside and restored
+        candidates.clear();
+        skipped.clear();
+        while (!open_teams.empty() && candidates.size() < kBalanceCandidates) {
+            size_t team_index = get<2>(open_teams.top());
+            if (!candidates.empty() && get<0>(open_teams.top()) != teams[candidates.front()].size()) break;
+            open_teams.pop();
+            (canWorkTogether(team_index, id) ? candidates : skipped).push_back(team_index);
+        }
+
+        size_t best = SIZE_MAX;
+        long long best_fit = 0;
+        for (size_t team_index : candidates) {
+            long long fit = 0;
+            for (int k = 0; k < 3; ++k) {
+                fit += shortfall[team_index][k] * roster->skill(k, id);
+            }
+            if (best == SIZE_MAX || fit > best_fit) {
+                best = team_index;
+                best_fit = fit;
             }
-            index++;
+        }
+
+        if (best == SIZE_MAX) {
+            leftover.push_back(id);
+        } else {
+            addToTeam(best, id);
+            for (int k = 0; k < 3; ++k) {
+                shortfall[best][k] += column_sums[k] - static_cast<long long>(roster->skill(k, id)) * num_students;
+            }
+        }
+        for (size_t team_index : candidates) {
+            if (teams[team_index].size() < team_targets[team_index]) {
+                open_teams.push(HeapEntry(teams[team_index].size(), surplus(team_index), team_index));
+            }
+        }
+        for (size_t team_index : skipped) {
+            open_teams.push(HeapEntry(teams[team_index].size(), surplus(team_index), team_index));
         }
     }
+
+    return repairTeams(leftover);
 }
 
-// Distribute remaining students among teams
-void TeamBuilder::distributeRemainingStudents(vector<Student>& remaining_students, set<string>& assigned_students) {
-    while (!remaining_students.empty()) {
-        bool student_added = false;
-        for (auto& team : teams) {
-            if (team.size() < static_cast<size_t>(team_size)) {
-                for (auto it = remaining_students.begin(); it != remaining_students.end(); ++it) {
-                    if (assigned_students.find(it->username) == assigned_students.end() && canWorkTogether(team, *it)) {
-                        team.push_back(*it);
-                        assigned_students.insert(it->username);
-                        remaining_students.erase(it);
-                        student_added = true;
-                        break;
-                    }
-                }
+// Difference between the highest and lowest team total for each skill
+array<int, 3> TeamBuilder::skillSpread() const {
+    array<int, 3> low = {{INT_MAX, INT_MAX, INT_MAX}};
+    array<int, 3> high = {{INT_MIN, INT_MIN, INT_MIN}};
+    for (const auto& team : teams) {
+        array<int, 3> totals = roster->skillTotals(team.data(), team.size());
+        for (int k = 0; k < 3; ++k) {
+            low[k] = min(low[k], totals[k]);
+            high[k] = max(high[k], totals[k]);
+        }
+    }
+    if (teams.empty()) return {{0, 0, 0}};
+    return {{high[0] - low[0], high[1] - low[1], high[2] - low[2]}};
+}
+
+// Distribute remaining students among teams [first_team, last_team). The pool only shrinks and forbidden sets only
+// grow, so a team that is full or has no compatible student left never needs revisiting.
+void TeamBuilder::distributeRemainingStudents(CandidatePool& pool, size_t first_team, size_t last_team) {
+    size_t team_index = first_team;
+    while (!pool.empty() && team_index < last_team) {
+        if (teams[team_index].size() >= team_targets[team_index]) {
+            ++team_index;
+            continue;
+        }
+        uint32_t id = nextCompatible(pool, team_index);
+        if (id == kNoStudent) {
+            ++team_index;
+            continue;
+        }
+        addToTeam(team_index, id);
+        pool.remove(id);
+    }
+}
+
+// Preference links between a student and a team's members, counted in both directions
+int TeamBuilder::linksTo(uint32_t id, size_t team_index) const {
+    int links = 0;
+    for (uint32_t other : roster->wants(id)) {
+        links += team_of[other] == team_index ? 1 : 0;
+    }
+    for (uint32_t other : roster->wantedBy(id)) {
+        links += team_of[other] == team_index ? 1 : 0;
+    }
+    return links;
+}
+
+// Sum of a team's three skills, before any minimum-score adjustment
+int TeamBuilder::rawTotal(size_t team_index) const {
+    array<int, 3> totals = roster->skillTotals(teams[team_index].data(), teams[team_index].size());
+    return totals[0] + totals[1] + totals[2];
+}
+
+// Size of the smallest team, capped at team_size; only teams of this size may grow
+size_t TeamBuilder::smallestTeamSize() const {
+    size_t smallest = team_size;
+    for (const auto& team : teams) {
+        smallest = min(smallest, team.size());
+    }
+    return smallest;
+}
+
+// The compatible team smaller than `below` that best suits `id`: the smallest, then the one with
+// the most preference links (the lowest skill total in skills mode). teams.size() if none fits.
+size_t TeamBuilder::chooseTeam(uint32_t id, size_t below, size_t skip) const {
+    below = min(below, team_size);
+    size_t best = teams.size();
+    int best_key = 0;
+    for (size_t i = 0; i < teams.size(); ++i) {
+        if (i == skip || teams[i].size() >= below) continue;
+        if (best != teams.size() && teams[i].size() > teams[best].size()) continue;
+        if (!canWorkTogether(i, id)) continue;
+        int key = prioritize_skills ? -rawTotal(i) : linksTo(id, i);
+        if (best == teams.size() || teams[i].size() < teams[best].size() || key > best_key) {
+            best = i;
+            best_key = key;
+        }
+    }
+    return best;
+}
+
+// Teams holding any conflict partner of the students, i.e. whose forbidden sets name them
+vector<size_t> TeamBuilder::teamsNear(initializer_list<uint32_t> ids) const {
+    vector<size_t> near;
+    for (uint32_t id : ids) {
+        for (uint32_t partner : roster->conflicts(id)) {
+            if (team_of[partner] != kNoStudent) near.push_back(team_of[partner]);
+        }
+    }
+    sort(near.begin(), near.end());
+    near.erase(unique(near.begin(), near.end()), near.end());
+    return near;
+}
+
+void TeamBuilder::placeStudent(size_t team_index, uint32_t id) {
+    addToTeam(team_index, id);
+    team_of[id] = static_cast<uint32_t>(team_index);
+    dirty_teams.push_back(team_index);
+}
+
+void TeamBuilder::unplaceStudent(uint32_t id) {
+    size_t team_index = team_of[id];
+    removeFromTeam(team_index, id);
+    team_of[id] = kNoStudent;
+    dirty_teams.push_back(team_index);
+}
+
+void TeamBuilder::relocate(uint32_t id, size_t team_index) {
+    unplaceStudent(id);
+    placeStudent(team_index, id);
+    ++students_moved;
+}
+
+// The student to pull into a team from one of the teams of size `from_size`: compatible, and
+// losing the fewest preference links by the move. Students linked to the team are tried first;
+// no one else can gain a link, so the scan stops at the first of them who loses none.
+uint32_t TeamBuilder::pullCandidate(size_t team_index, size_t from_size) const {
+    uint32_t best = kNoStudent;
+    int best_cost = INT_MAX;
+    auto consider = [&](uint32_t id) {
+        size_t home = team_of[id];
+        if (home == kNoStudent || home == team_index || teams[home].size() != from_size ||
+            !canWorkTogether(team_index, id)) {
+            return;
+        }
+        int cost = linksTo(id, home) - linksTo(id, team_index);
+        if (cost < best_cost) {
+            best = id;
+            best_cost = cost;
+        }
+    };
+    for (uint32_t member : teams[team_index]) {
+        for (uint32_t other : roster->wants(member)) consider(other);
+        for (uint32_t other : roster->wantedBy(member)) consider(other);
+    }
+    for (size_t i = 0; i < teams.size() && best_cost > 0; ++i) {
+        if (i == team_index || teams[i].size() != from_size) continue;
+        for (uint32_t member : teams[i]) {
+            consider(member);
+            if (best_cost <= 0) break;
+        }
+    }
+    return best;
+}
+
+// Every team is full: start a new one around `id` and bring it up to the balanced size with one
+// student from each of the largest teams
+void TeamBuilder::openTeamFor(uint32_t id) {
+    size_t opened = teams.size();
+    teams.emplace_back();
+    team_forbidden.emplace_back();
+    team_targets.push_back(0);
+    team_scores.push_back({{0, 0, 0}});
+    team_totals.push_back(0);
+    placeStudent(opened, id);
+
+    size_t fill = roster->size() / teams.size();
+    while (teams[opened].size() < fill) {
+        size_t largest = 0;
+        for (size_t i = 0; i < opened; ++i) {
+            largest = max(largest, teams[i].size());
+        }
+        uint32_t pulled = pullCandidate(opened, largest);
+        if (pulled == kNoStudent) break;
+        relocate(pulled, opened);
+    }
+}
+
+// Conflicts keep `id` out of every team smaller than `below`: move the one student blocking it
+// from such a team to another with room. Returns the team it freed up, or teams.size().
+size_t TeamBuilder::makeRoomFor(uint32_t id, size_t below) {
+    for (size_t i = 0; i < teams.size(); ++i) {
+        if (teams[i].size() >= below) continue;
+        uint32_t blocker = kNoStudent;
+        size_t blockers = 0;
+        for (uint32_t member : teams[i]) {
+            if (roster->hasConflict(id, member)) {
+                blocker = member;
+                ++blockers;
             }
-            if (student_added) {
-                break;
+        }
+        if (blockers != 1) continue;
+        size_t target = chooseTeam(blocker, below, i);
+        if (target == teams.size()) continue;
+        relocate(blocker, target);
+        return i;
+    }
+    return teams.size();
+}
+
+// A change left `id` in conflict with its team: trade places with a student of another team
+// so that both fit, preferring the trade that keeps the most preference links
+bool TeamBuilder::swapOut(uint32_t id) {
+    size_t home = team_of[id];
+    auto fitsHome = [&](uint32_t other) {
+        for (uint32_t member : teams[home]) {
+            if (member != id && roster->hasConflict(other, member)) return false;
+        }
+        return true;
+    };
+
+    uint32_t best = kNoStudent;
+    int best_gain = INT_MIN;
+    for (size_t i = 0; i < teams.size(); ++i) {
+        if (i == home) continue;
+        // Only a team where at most one member conflicts with `id` can take it, trading that member
+        uint32_t blocker = kNoStudent;
+        size_t blockers = 0;
+        for (uint32_t member : teams[i]) {
+            if (roster->hasConflict(id, member)) {
+                blocker = member;
+                ++blockers;
+            }
+        }
+        if (blockers > 1) continue;
+        int joining = linksTo(id, i);
+        for (uint32_t other : teams[i]) {
+            if ((blocker != kNoStudent && other != blocker) || !fitsHome(other)) continue;
+            int gain = joining + linksTo(other, home) - linksTo(other, i);
+            if (gain > best_gain) {
+                best = other;
+                best_gain = gain;
             }
         }
-        if (!student_added) {
-            break;
+    }
+    if (best == kNoStudent) return false;
+
+    size_t away = team_of[best];
+    unplaceStudent(id);
+    relocate(best, home);
+    placeStudent(away, id);
+    return true;
+}
+
+// A student left a team: an unassigned student who fits takes the place; otherwise a team is
+// dropped if the roster now fits in fewer, or one student is pulled in to keep sizes within one
+void TeamBuilder::rebalanceAfterLeaving(size_t team_index) {
+    for (size_t i = 0; i < unassigned_students.size(); ++i) {
+        uint32_t id = unassigned_students[i];
+        if (canWorkTogether(team_index, id)) {
+            unassigned_students.erase(unassigned_students.begin() + i);
+            placeStudent(team_index, id);
+            return;
+        }
+    }
+
+    size_t needed = (roster->size() + team_size - 1) / team_size;
+    if (needed < teams.size()) {
+        size_t smallest = team_index;
+        for (size_t i = 0; i < teams.size(); ++i) {
+            if (teams[i].size() < teams[smallest].size()) smallest = i;
         }
+        dissolveTeam(smallest);
+        return;
+    }
+
+    size_t largest = 0;
+    for (const auto& team : teams) {
+        largest = max(largest, team.size());
+    }
+    if (largest <= teams[team_index].size() + 1) return;
+    uint32_t pulled = pullCandidate(team_index, largest);
+    if (pulled != kNoStudent) {
+        relocate(pulled, team_index);
     }
 }
+
+// Spread a team's members over the teams with room and close it; the last team takes its index
+void TeamBuilder::dissolveTeam(size_t team_index) {
+    vector<uint32_t> members = teams[team_index];
+    for (uint32_t id : members) {
+        size_t target = chooseTeam(id, team_size, team_index);
+        if (target == teams.size()) {
+            unplaceStudent(id);
+            unassigned_students.push_back(id);
+        } else {
+            relocate(id, target);
+        }
+    }
+
+    size_t last = teams.size() - 1;
+    if (team_index != last) {
+        teams[team_index].swap(teams[last]);
+        team_forbidden[team_index] = move(team_forbidden[last]);
+        team_targets[team_index] = team_targets[last];
+        team_scores[team_index] = team_scores[last];
+        team_totals[team_index] = team_totals[last];
+        for (uint32_t id : teams[team_index]) {
+            team_of[id] = static_cast<uint32_t>(team_index);
+        }
+        replace(dirty_teams.begin(), dirty_teams.end(), last, team_index);
+    } else {
+        dirty_teams.erase(remove(dirty_teams.begin(), dirty_teams.end(), last), dirty_teams.end());
+    }
+    teams.pop_back();
+    team_forbidden.pop_back();
+    team_targets.pop_back();
+    team_scores.pop_back();
+    team_totals.pop_back();
+}
+
+// Rescore the teams a change touched. Teams are not re-sorted, so everyone else keeps their
+// team number as well as their teammates.
+void TeamBuilder::finishUpdate() {
+    sort(dirty_teams.begin(), dirty_teams.end());
+    dirty_teams.erase(unique(dirty_teams.begin(), dirty_teams.end()), dirty_teams.end());
+    scoreTeams(dirty_teams.data(), dirty_teams.size());
+    for (size_t i : dirty_teams) {
+        team_targets[i] = teams[i].size();
+    }
+    dirty_teams.clear();
+}
+
+bool TeamBuilder::addStudent(const Student& student) {
+    if (roster->find(student.username) != kNoStudent) return false;
+    Roster& editable = mutableRoster();
+    students_moved = 0;
+    team_of.resize(roster->size(), kNoStudent);
+    uint32_t id = editable.addStudent(student);
+    team_of.push_back(kNoStudent);
+    // Teams holding the newcomer's conflict partners must now refuse them
+    for (size_t i : teamsNear({id})) {
+        rebuildForbidden(i);
+    }
+
+    size_t needed = (roster->size() + team_size - 1) / team_size;
+    if (needed > teams.size()) {
+        openTeamFor(id);
+    } else {
+        // Only the smallest teams may grow, so sizes stay within one
+        size_t below = smallestTeamSize() + 1;
+        size_t target = chooseTeam(id, below, teams.size());
+        if (target == teams.size()) {
+            target = makeRoomFor(id, below);
+        }
+        if (target == teams.size()) {
+            unassigned_students.push_back(id);
+        } else {
+            placeStudent(target, id);
+        }
+    }
+    finishUpdate();
+    return true;
+}
+
+bool TeamBuilder::removeStudent(const string& username) {
+    uint32_t id = roster->find(username);
+    if (id == kNoStudent) return false;
+    Roster& editable = mutableRoster();
+    students_moved = 0;
+    team_of.resize(roster->size(), kNoStudent);
+
+    size_t left = team_of[id];
+    if (left != kNoStudent) {
+        unplaceStudent(id);
+    } else {
+        unassigned_students.erase(find(unassigned_students.begin(), unassigned_students.end(), id));
+    }
+
+    // Forbidden sets name students by ID, so those that name the leaver or the last student,
+    // who is renumbered into the leaver's slot, go stale with the roster edit
+    vector<size_t> stale = teamsNear({id, roster->size() - 1});
+    uint32_t moved = editable.removeStudent(id);
+    if (moved != kNoStudent) {
+        uint32_t team_index = team_of[moved];
+        vector<uint32_t>& holder = team_index == kNoStudent ? unassigned_students : teams[team_index];
+        replace(holder.begin(), holder.end(), moved, id);
+        team_of[id] = team_index;
+    }
+    team_of.pop_back();
+    for (size_t i : stale) {
+        rebuildForbidden(i);
+    }
+
+    if (left != kNoStudent) {
+        rebalanceAfterLeaving(left);
+    }
+    finishUpdate();
+    return true;
+}
+
+bool TeamBuilder::updatePreferences(const string& username, const vector<string>& want_to_work_with,
+                                    const vector<string>& dont_want_to_work_with) {
+    uint32_t id = roster->find(username);
+    if (id == kNoStudent) return false;
+    Roster& editable = mutableRoster();
+    students_moved = 0;
+    team_of.resize(roster->size(), kNoStudent);
+
+    // Rebuild the forbidden sets naming the student under either the old or the new lists
+    vector<size_t> stale = teamsNear({id});
+    editable.updatePreferences(id, want_to_work_with, dont_want_to_work_with);
+    vector<size_t> fresh = teamsNear({id});
+    stale.insert(stale.end(), fresh.begin(), fresh.end());
+    size_t home = team_of[id];
+    if (home != kNoStudent) stale.push_back(home);
+    sort(stale.begin(), stale.end());
+    stale.erase(unique(stale.begin(), stale.end()), stale.end());
+    for (size_t i : stale) {
+        rebuildForbidden(i);
+    }
+
+    if (home == kNoStudent) {
+        // An unassigned student may fit somewhere under the new lists, on one of the smallest teams
+        size_t target = chooseTeam(id, smallestTeamSize() + 1, teams.size());
+        if (target != teams.size()) {
+            unassigned_students.erase(find(unassigned_students.begin(), unassigned_students.end(), id));
+            placeStudent(target, id);
+        }
+    } else if (team_forbidden[home].contains(id) && !swapOut(id)) {
+        // No trade resolves the new conflict: the student waits unassigned rather than break the team
+        unplaceStudent(id);
+        unassigned_students.push_back(id);
+        rebalanceAfterLeaving(home);
+    }
+    finishUpdate();
+    return true;
+}
+
 // Calculate scores for each team
 void TeamBuilder::calculateTeamScores() {
-    team_scores.clear();
-    for (const auto& team : teams) {
-        int programming_score = 0;
-        int debugging_score = 0;
-        int algorithm_score = 0;
-        for (const auto& member : team) {
-            programming_score += member.programming_skill;
-            debugging_score += member.debugging_skill;
-            algorithm_score += member.algorithm_skill;
-        }
-        team_scores.push_back({programming_score, debugging_score, algorithm_score});
-    }
-    // Set the minimum scores for each team size
-    if (prioritize_skills) {
-        for (auto& scores : team_scores) {
-            if (team_size == 3) {
-                if (scores[0] < 5) scores[0] = 5;
-                if (scores[1] < 5) scores[1] = 5;
-                if (scores[2] < 5) scores[2] = 5;
-                if (scores[0] + scores[1] + scores[2] < 16) {
-                    int diff = 16 - (scores[0] + scores[1] + scores[2]);
-                    scores[0] += diff / 3;
-                    scores[1] += diff / 3;
-                    scores[2] += diff - 2 * (diff / 3);
-                }
-            } else if (team_size == 4) {
-                if (scores[0] < 7) scores[0] = 7;
-                if (scores[1] < 7) scores[1] = 7;
-                if (scores[2] < 7) scores[2] = 7;
-                if (scores[0] + scores[1] + scores[2] < 22) {
-                    int diff = 22 - (scores[0] + scores[1] + scores[2]);
-                    scores[0] += diff / 3;
-                    scores[1] += diff / 3;
-                    scores[2] += diff - 2 * (diff / 3);
-                }
-            }
+    {
+        // Scoring only; the sort below has its own phase
+        STATS_TIMER(Scoring);
+        team_scores.resize(teams.size());
+        // Cache the totals the sort compares on
+        team_totals.resize(teams.size());
+        vector<size_t> all(teams.size());
+        iota(all.begin(), all.end(), 0);
+        scoreTeams(all.data(), all.size());
+    }
+    sortTeamsByScore();
+}
+
+// Score the listed teams with the kernels for team size N. Teams hold N or N - 1 members
+// (fewer only on tiny rosters), so both common sizes get a fully unrolled sum; N == 0 is the
+// generic path for sizes past kMaxFixedTeamSize.
+template <size_t N>
+void TeamBuilder::scoreTeams(const size_t* indices, size_t count) {
+    constexpr size_t kSmaller = N > kMinFixedTeamSize ? N - 1 : 0;
+    SkillMinimum minimum = N != 0 ? kSkillMinimums[N] : SkillMinimum{0, 0};
+    bool raise = prioritize_skills && (N != 0 ? hasSkillMinimum(N) : skillMinimumFor(team_size, minimum));
+    for (size_t i = 0; i < count; ++i) {
+        size_t team_index = indices[i];
+        const vector<uint32_t>& team = teams[team_index];
+        array<int, 3>& scores = team_scores[team_index];
+        if (N != 0 && team.size() == N) {
+            scores = roster->skillTotals<N>(team.data());
+        } else if (kSmaller != 0 && team.size() == kSmaller) {
+            scores = roster->skillTotals<kSmaller>(team.data());
+        } else {
+            scores = roster->skillTotals(team.data(), team.size());
+        }
+        // Set the minimum scores for each team size
+        if (raise) {
+            raiseToMinimum(scores, minimum);
         }
+        team_totals[team_index] = scores[0] + scores[1] + scores[2];
     }
+}
+
+void TeamBuilder::scoreTeams(const size_t* indices, size_t count) {
+    withTeamSize(team_size, [&](auto size) { scoreTeams<decltype(size)::value>(indices, count); });
+}
 
-    // Sort teams based on the sum of their scores
+// Sort teams based on the sum of their scores
+void TeamBuilder::sortTeamsByScore() {
+    STATS_TIMER(Sort);
     vector<size_t> indices(teams.size());
     iota(indices.begin(), indices.end(), 0);
     sort(indices.begin(), indices.end(), [this](size_t a, size_t b) {
-        int total_score_a = team_scores[a][0] + team_scores[a][1] + team_scores[a][2];
-        int total_score_b = team_scores[b][0] + team_scores[b][1] + team_scores[b][2];
-        return total_score_a > total_score_b;
+        return team_totals[a] > team_totals[b];
     });
 
-    vector<vector<Student>> sorted_teams;
-    for (size_t index : indices) {
-        sorted_teams.push_back(teams[index]);
+    // Apply the permutation by moving each team's buffers, never copying members
+    vector<vector<uint32_t>> sorted_teams(teams.size());
+    vector<ForbiddenSet> sorted_forbidden(teams.size());
+    vector<size_t> sorted_targets(teams.size());
+    vector<array<int, 3>> sorted_scores(teams.size());
+    vector<int> sorted_totals(teams.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        sorted_teams[i].swap(teams[indices[i]]);
+        sorted_forbidden[i] = move(team_forbidden[indices[i]]);
+        sorted_targets[i] = team_targets[indices[i]];
+        sorted_scores[i] = team_scores[indices[i]];
+        sorted_totals[i] = team_totals[indices[i]];
+    }
+    teams.swap(sorted_teams);
+    team_forbidden.swap(sorted_forbidden);
+    team_targets.swap(sorted_targets);
+    team_scores.swap(sorted_scores);
+    team_totals.swap(sorted_totals);
+    indexTeams();
+}
+
+// Record which team each student is on, for the incremental changes
+void TeamBuilder::indexTeams() {
+    team_of.assign(roster->size(), kNoStudent);
+    for (size_t i = 0; i < teams.size(); ++i) {
+        for (uint32_t id : teams[i]) {
+            team_of[id] = static_cast<uint32_t>(i);
+        }
+    }
+}
+
+
+// Hand every team, in order, to a writer
+void TeamBuilder::writeTeams(TeamWriter& writer) const {
+    writer.begin(teams.size(), unassigned_students.size());
+    for (size_t i = 0; i < teams.size(); ++i) {
+        writer.team(i, teams[i], team_scores[i]);
     }
-    teams = move(sorted_teams);
+    writer.end(unassigned_students);
 }
 
+// Bytes the teams take in a text format: every username plus a little per team, so the
+// buffer can be sized for the whole output up front
+size_t TeamBuilder::outputBytes() const {
+    size_t bytes = 64 * (teams.size() + 1);
+    for (uint32_t id = 0; id < roster->size(); ++id) {
+        bytes += roster->student(id).username.size() + 4;
+    }
+    return bytes;
+}
 
 // Print teams and their scores
 void TeamBuilder::printTeamsAndScores() {
-    for (size_t i = 0; i < teams.size(); ++i) {
-        cout << "Team " << i + 1 << ":\n";
-        for (const auto& member : teams[i]) {
-            cout << member.username << " ";
-        }
-        cout << "\nProgramming skill score: " << team_scores[i][0]
-             << ", Debugging skill score: " << team_scores[i][1]
-             << ", Algorithm skill score: " << team_scores[i][2] << "\n\n";
+    OutputBuffer out(min(outputBytes(), kMaxOutputBuffer));
+    out.attach(cout);
+    writeTeams(*makeTeamWriter(TeamFormat::Text, *roster, out));
+    WriteResult result = out.finish();
+    if (!result.ok) {
+        cerr << "Failed to print teams: " << result.error << endl;
     }
 }
 
-// Write teams to a CSV file
-void TeamBuilder::writeTeamsToFile(const string& filename) {
-    ofstream outfile(filename);
-    if (outfile.is_open()) {
-        for (size_t i = 0; i < teams.size(); ++i) {
-            outfile << "Team " << i + 1 << ",";
-            for (const auto& member : teams[i]) {
-                outfile << member.username << ",";
-            }
-            outfile << "\n";
-        }
-        outfile.close();
+// Write teams to a file; a failure comes back in the result, with the reason
+WriteResult TeamBuilder::writeTeamsToFile(const string& filename, TeamFormat format) {
+    STATS_TIMER(Write);
+    OutputBuffer out(min(outputBytes(), kMaxOutputBuffer));
+    if (out.open(filename)) {
+        writeTeams(*makeTeamWriter(format, *roster, out));
+    }
+    WriteResult result = out.finish();
+    if (result.ok && verbose) {
         cout << "Teams written to file: " << filename << endl;
-    } else {
-        cerr << "Failed to open file for writing: " << filename << endl;
     }
+    return result;
 }
@@ -1,42 +1,189 @@
 #ifndef TEAMBUILDER_HPP
 #define TEAMBUILDER_HPP
 
+#include "Roster.hpp"
+#include "Optimizer.hpp"
+#include "CandidatePool.hpp"
+#include "ExactSolver.hpp"
+#include "TeamSize.hpp"
+#include "Decomposition.hpp"
+#include "TeamWriter.hpp"
 #include <vector>
+#include <array>
 #include <string>
-#include <map>
-#include <set>
-
-struct Student {
-    std::string username;
-    int programming_skill;
-    int debugging_skill;
-    int algorithm_skill;
-    std::vector<std::string> dont_want_to_work_with;
-    std::vector<std::string> want_to_work_with;
+#include <memory>
+#include <initializer_list>
+#include <atomic>
+#include <cstdint>
+
+// Stops a running search from another thread. Copies share one flag, so a caller keeps a copy
+// and cancels it while the search polls its own.
+class CancellationToken {
+public:
+    CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+    void cancel() const { flag->store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return flag->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+// Limits for the backtracking search that repairs incomplete teams
+struct SolverBudget {
+    uint64_t max_backtracks = 1000000;
+    double time_limit_seconds = 10.0;
+    CancellationToken cancellation;  // Checked along with the time limit
+};
+
+enum class FormationStatus {
+    Success,          // Every student is on a team and no team has a conflict
+    Infeasible,       // The search proved no conflict-free assignment exists
+    BudgetExhausted   // The search gave up; some students are left unassigned
+};
+
+// Read-only view of one team: iterates the members' roster records without copying them
+class TeamView {
+public:
+    class iterator {
+    public:
+        iterator(const Roster& roster, const uint32_t* position) : roster(&roster), position(position) {}
+        const Student& operator*() const { return roster->student(*position); }
+        const Student* operator->() const { return &roster->student(*position); }
+        iterator& operator++() { ++position; return *this; }
+        bool operator==(const iterator& other) const { return position == other.position; }
+        bool operator!=(const iterator& other) const { return position != other.position; }
+
+    private:
+        const Roster* roster;
+        const uint32_t* position;
+    };
+
+    TeamView(const Roster& roster, const std::vector<uint32_t>& ids) : roster(roster), ids(ids) {}
+    size_t size() const { return ids.size(); }
+    const Student& operator[](size_t index) const { return roster.student(ids[index]); }
+    const std::vector<uint32_t>& memberIds() const { return ids; }
+    iterator begin() const { return iterator(roster, ids.data()); }
+    iterator end() const { return iterator(roster, ids.data() + ids.size()); }
+
+private:
+    const Roster& roster;
+    const std::vector<uint32_t>& ids;
 };
 
 class TeamBuilder {
 public:
+    // The roster copies the students' names, so `students` may be dropped afterwards
     TeamBuilder(const std::vector<Student>& students, int team_size, bool prioritize_skills);
-    void formTeams(bool prioritize_preferences);
+    // Shares an already built roster; several builders may use the same one concurrently
+    TeamBuilder(std::shared_ptr<const Roster> roster, int team_size, bool prioritize_skills);
+    void setSolverBudget(const SolverBudget& budget) { solver_budget = budget; }
+    void setOptimizerOptions(const OptimizerOptions& options) { optimizer_options = options; }
+    void setExactOptions(const ExactOptions& options) { exact_options = options; }
+    // Form preference teams per connected component, in parallel
+    void setDecompositionOptions(const DecompositionOptions& options) { decomposition_options = options; }
+    // A non-zero seed shuffles leader choice and fill order; 0 keeps roster order
+    void setFormationSeed(uint64_t seed) { formation_seed = seed; }
+    void setVerbose(bool enabled) { verbose = enabled; }
+    FormationStatus formTeams(bool prioritize_preferences);
+    // Replace the current teams with an assignment formed elsewhere, e.g. by a portfolio search
+    void setTeams(const std::vector<std::vector<uint32_t>>& members, const std::vector<uint32_t>& unassigned);
+    // Teams are roster IDs; views resolve them to the shared, immutable Student records
+    const std::vector<std::vector<uint32_t>>& teamMembers() const { return teams; }
+    size_t teamCount() const { return teams.size(); }
+    TeamView team(size_t index) const { return TeamView(*roster, teams[index]); }
+    const std::array<int, 3>& teamScores(size_t index) const { return team_scores[index]; }
+    // The first incremental change on a shared roster swaps in a private copy
+    const Roster& getRoster() const { return *roster; }
+    const std::vector<uint32_t>& unassignedStudents() const { return unassigned_students; }
+    // Outcome of the last exact search, if exact mode ran
+    const ExactResult& exactResult() const { return exact_result; }
     void printTeamsAndScores();
-    void writeTeamsToFile(const std::string& filename);
+    WriteResult writeTeamsToFile(const std::string& filename, TeamFormat format = TeamFormat::Csv);
+    // Stream the teams, in their current order, then the unassigned students, to any format
+    void writeTeams(TeamWriter& writer) const;
+    void calculateTeamScores();
+    // Highest minus lowest team total for each skill, before any minimum-score adjustment
+    std::array<int, 3> skillSpread() const;
+
+    // Incremental changes to formed teams: only the teams a change touches are repaired and
+    // everyone else keeps their team. Team sizes stay within one of each other. A shared
+    // roster is copied on the first change so other builders never see it move.
+    // Each returns false if the username is already taken (add) or not on the roster.
+    bool addStudent(const Student& student);
+    // The last roster ID is renumbered into the leaver's slot
+    bool removeStudent(const std::string& username);
+    bool updatePreferences(const std::string& username, const std::vector<std::string>& want_to_work_with,
+                           const std::vector<std::string>& dont_want_to_work_with);
+    // Students other than the one named who changed teams in the last incremental change
+    size_t studentsMoved() const { return students_moved; }
 
 private:
-    std::vector<Student> students;
-    int team_size;
+    std::shared_ptr<const Roster> shared_roster;
+    std::shared_ptr<Roster> owned_roster;  // Set once no other builder can see the roster
+    const Roster* roster;
+    size_t team_size;
     bool prioritize_skills;  // Add this member variable
-    std::vector<std::vector<Student>> teams;
-    std::vector<std::vector<int>> team_scores;
-    std::map<std::string, Student> student_map;
-
-    void loadStudentMap();
-    bool canWorkTogether(const std::vector<Student>& team, const Student& new_member);
-    void formTeamsByPreferences();
-    void formTeamsBySkills();
-    void distributeRemainingStudents(std::vector<Student>& remaining_students, std::set<std::string>& assigned_students);
-    void assignMinimumPreferences(std::vector<Student>& remaining_students, std::set<std::string>& assigned_students);
-    void calculateTeamScores();
+    std::vector<std::vector<uint32_t>> teams;
+    std::vector<ForbiddenSet> team_forbidden;  // Union of the members' conflicts, per team
+    std::vector<size_t> team_targets;  // Team sizes differ by at most one when students don't divide evenly
+    std::vector<std::array<int, 3>> team_scores;  // Programming, debugging, algorithm
+    std::vector<int> team_totals;  // Sum of each team's scores, for the sort
+    std::vector<uint32_t> unassigned_students;
+    std::vector<uint32_t> team_of;  // Team index per student, or kNoStudent; rebuilt whenever teams are sorted
+    std::vector<size_t> dirty_teams;  // Teams an incremental change touched, rescored when it finishes
+    size_t students_moved = 0;
+    SolverBudget solver_budget;
+    OptimizerOptions optimizer_options;
+    ExactOptions exact_options;
+    ExactResult exact_result;
+    DecompositionOptions decomposition_options;
+    uint64_t formation_seed = 0;
+    bool verbose = true;
+
+    struct SearchContext;
+
+    void resetTeams(size_t num_teams);
+    void shuffleOrder(std::vector<uint32_t>& order) const;
+    void addToTeam(size_t team_index, uint32_t id);
+    void removeFromTeam(size_t team_index, uint32_t id);
+    void rebuildForbidden(size_t team_index);
+    bool canWorkTogether(size_t team_index, uint32_t id) const;
+    size_t teamBytes() const;
+    size_t outputBytes() const;
+    FormationStatus formTeamsByPreferences();
+    FormationStatus formTeamsBySkills();
+    FormationStatus formTeamsByComponents();
+    uint32_t nextCompatible(const CandidatePool& pool, size_t team_index) const;
+    void fillTeamsByPreferences(CandidatePool& pool, size_t first_team, size_t last_team, bool trace);
+    void distributeRemainingStudents(CandidatePool& pool, size_t first_team, size_t last_team);
+    FormationStatus repairTeams(std::vector<uint32_t>& leftover);
+    bool placeConstrained(std::vector<uint32_t>& pool, size_t placed, const std::vector<size_t>& released, SearchContext& context);
+    void placeUnconstrained(const std::vector<uint32_t>& pool, const std::vector<size_t>& released);
+    bool formTeamsExactly();
+    void improveTeams();
+    template <size_t N>
+    void scoreTeams(const size_t* indices, size_t count);
+    void scoreTeams(const size_t* indices, size_t count);
+    void sortTeamsByScore();
+    void indexTeams();
+
+    Roster& mutableRoster();
+    void adoptRoster(std::shared_ptr<Roster> owned);
+    int linksTo(uint32_t id, size_t team_index) const;
+    int rawTotal(size_t team_index) const;
+    size_t smallestTeamSize() const;
+    size_t chooseTeam(uint32_t id, size_t below, size_t skip) const;
+    std::vector<size_t> teamsNear(std::initializer_list<uint32_t> ids) const;
+    void placeStudent(size_t team_index, uint32_t id);
+    void unplaceStudent(uint32_t id);
+    void relocate(uint32_t id, size_t team_index);
+    uint32_t pullCandidate(size_t team_index, size_t from_size) const;
+    void openTeamFor(uint32_t id);
+    size_t makeRoomFor(uint32_t id, size_t below);
+    bool swapOut(uint32_t id);
+    void rebalanceAfterLeaving(size_t team_index);
+    void dissolveTeam(size_t team_index);
+    void finishUpdate();
 };
 
 #endif // TEAMBUILDER_HPP
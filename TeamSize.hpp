@@ -0,0 +1,76 @@
+#ifndef TEAMSIZE_HPP
+#define TEAMSIZE_HPP
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+// Team sizes with compile-time specialised scoring and conflict kernels; larger teams
+// take the generic path, which loops over a runtime member count
+const size_t kMinFixedTeamSize = 2;
+const size_t kMaxFixedTeamSize = 8;
+
+// Minimum team skill scores from the grading rubric: each skill must reach per_skill and
+// the three together must reach total
+struct SkillMinimum {
+    int per_skill;
+    int total;
+};
+
+// Indexed by team size. The rubric only grades teams of 3 and 4; other sizes have no minimum.
+constexpr SkillMinimum kSkillMinimums[kMaxFixedTeamSize + 1] = {
+    {0, 0}, {0, 0}, {0, 0}, {5, 16}, {7, 22}, {0, 0}, {0, 0}, {0, 0}, {0, 0}};
+
+constexpr bool hasSkillMinimum(size_t team_size) {
+    return team_size <= kMaxFixedTeamSize && kSkillMinimums[team_size].total > 0;
+}
+
+inline bool skillMinimumFor(size_t team_size, SkillMinimum& minimum) {
+    if (!hasSkillMinimum(team_size)) return false;
+    minimum = kSkillMinimums[team_size];
+    return true;
+}
+
+// True if a team's raw totals fall short of the rubric minimum for its size
+inline bool missesMinimum(const std::array<int, 3>& totals, size_t team_size) {
+    SkillMinimum minimum;
+    return team_size > 0 && skillMinimumFor(team_size, minimum) &&
+           (totals[0] < minimum.per_skill || totals[1] < minimum.per_skill || totals[2] < minimum.per_skill ||
+            totals[0] + totals[1] + totals[2] < minimum.total);
+}
+
+// Raise scores to a minimum: each skill to per_skill, then the shortfall in the total is
+// split over the three skills with the remainder on the last
+inline void raiseToMinimum(std::array<int, 3>& scores, const SkillMinimum& minimum) {
+    if (scores[0] < minimum.per_skill) scores[0] = minimum.per_skill;
+    if (scores[1] < minimum.per_skill) scores[1] = minimum.per_skill;
+    if (scores[2] < minimum.per_skill) scores[2] = minimum.per_skill;
+    if (scores[0] + scores[1] + scores[2] < minimum.total) {
+        int diff = minimum.total - (scores[0] + scores[1] + scores[2]);
+        scores[0] += diff / 3;
+        scores[1] += diff / 3;
+        scores[2] += diff - 2 * (diff / 3);
+    }
+}
+
+// A team size as a compile-time constant; 0 stands for a size only known at run time
+template <size_t N>
+using TeamSizeTag = std::integral_constant<size_t, N>;
+
+// Call `f` with the team size as a TeamSizeTag, so the kernels it calls are instantiated for
+// that size; sizes outside kMinFixedTeamSize..kMaxFixedTeamSize get TeamSizeTag<0>
+template <typename Function>
+auto withTeamSize(size_t team_size, Function&& f) -> decltype(f(TeamSizeTag<0>())) {
+    switch (team_size) {
+        case 2: return f(TeamSizeTag<2>());
+        case 3: return f(TeamSizeTag<3>());
+        case 4: return f(TeamSizeTag<4>());
+        case 5: return f(TeamSizeTag<5>());
+        case 6: return f(TeamSizeTag<6>());
+        case 7: return f(TeamSizeTag<7>());
+        case 8: return f(TeamSizeTag<8>());
+        default: return f(TeamSizeTag<0>());
+    }
+}
+
+#endif // TEAMSIZE_HPP
@@ -0,0 +1,339 @@
+#include "TeamWriter.hpp"
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+bool teamFormatFromName(string_view name, TeamFormat& format) {
+    if (name == "csv") {
+        format = TeamFormat::Csv;
+    } else if (name == "scores") {
+        format = TeamFormat::CsvWithScores;
+    } else if (name == "json") {
+        format = TeamFormat::Json;
+    } else if (name == "binary") {
+        format = TeamFormat::Binary;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+TeamFormat teamFormatForFile(const string& filename) {
+    auto endsWith = [&](const char* suffix) {
+        size_t length = strlen(suffix);
+        return filename.size() >= length && filename.compare(filename.size() - length, length, suffix) == 0;
+    };
+    if (endsWith(".json")) return TeamFormat::Json;
+    if (endsWith(".bin")) return TeamFormat::Binary;
+    return TeamFormat::Csv;
+}
+
+const char* teamFormatExtension(TeamFormat format) {
+    switch (format) {
+        case TeamFormat::Json: return "json";
+        case TeamFormat::Binary: return "bin";
+        case TeamFormat::Text: return "txt";
+        default: return "csv";
+    }
+}
+
+OutputBuffer::OutputBuffer(size_t capacity) : buffer(capacity > 0 ? capacity : 1) {
+}
+
+OutputBuffer::~OutputBuffer() {
+    finish();
+}
+
+bool OutputBuffer::open(const string& filename) {
+    finish();
+    result = WriteResult();
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fail("cannot open " + filename);
+        return false;
+    }
+    owns_fd = true;
+    return true;
+}
+
+void OutputBuffer::attach(int descriptor) {
+    finish();
+    result = WriteResult();
+    fd = descriptor;
+    owns_fd = false;
+}
+
+void OutputBuffer::attach(ostream& target) {
+    finish();
+    result = WriteResult();
+    stream = &target;
+}
+
+void OutputBuffer::append(string_view text) {
+    while (!text.empty()) {
+        if (used == buffer.size()) drain();
+        size_t chunk = min(text.size(), buffer.size() - used);
+        memcpy(buffer.data() + used, text.data(), chunk);
+        used += chunk;
+        text.remove_prefix(chunk);
+    }
+}
+
+void OutputBuffer::appendNumber(long long value) {
+    char digits[24];
+    auto converted = to_chars(digits, digits + sizeof(digits), value);
+    append(string_view(digits, converted.ptr - digits));
+}
+
+void OutputBuffer::fail(const string& what) {
+    if (result.ok) {
+        result.ok = false;
+        result.error = what + ": " + strerror(errno);
+    }
+}
+
+// Hand the whole buffer to the kernel, retrying short writes; after a failure output is only discarded
+void OutputBuffer::drain() {
+    if (stream) {
+        if (result.ok && used > 0) {
+            if (stream->write(buffer.data(), used)) {
+                result.bytes += used;
+            } else {
+                result.ok = false;
+                result.error = "write failed";
+            }
+        }
+        used = 0;
+        return;
+    }
+    size_t offset = 0;
+    while (result.ok && fd >= 0 && offset < used) {
+        ssize_t written = ::write(fd, buffer.data() + offset, used - offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            fail("write failed");
+            break;
+        }
+        offset += static_cast<size_t>(written);
+        result.bytes += static_cast<size_t>(written);
+    }
+    used = 0;
+}
+
+bool OutputBuffer::flush() {
+    drain();
+    return result.ok;
+}
+
+WriteResult OutputBuffer::finish() {
+    if (stream) {
+        drain();
+        if (result.ok && !stream->flush()) {
+            result.ok = false;
+            result.error = "flush failed";
+        }
+        stream = nullptr;
+    }
+    if (fd >= 0) {
+        drain();
+        if (owns_fd && ::close(fd) != 0) {
+            fail("close failed");
+        }
+        fd = -1;
+        owns_fd = false;
+    }
+    used = 0;
+    return result;
+}
+
+namespace {
+
+// The original format: every field followed by a comma, including the last
+class CsvTeamWriter : public TeamWriter {
+public:
+    CsvTeamWriter(const Roster& roster, OutputBuffer& out) : TeamWriter(roster, out) {}
+    void begin(size_t, size_t) override {}
+    void team(size_t index, const vector<uint32_t>& members, const array<int, 3>&) override {
+        out.append("Team ");
+        out.appendNumber(static_cast<long long>(index + 1));
+        out.append(',');
+        for (uint32_t id : members) {
+            out.append(roster.student(id).username);
+            out.append(',');
+        }
+        out.append('\n');
+    }
+    void end(const vector<uint32_t>& unassigned) override {
+        if (unassigned.empty()) return;
+        out.append("Unassigned,");
+        for (uint32_t id : unassigned) {
+            out.append(roster.student(id).username);
+            out.append(',');
+        }
+        out.append('\n');
+    }
+};
+
+class ScoresCsvTeamWriter : public TeamWriter {
+public:
+    ScoresCsvTeamWriter(const Roster& roster, OutputBuffer& out) : TeamWriter(roster, out) {}
+    void begin(size_t, size_t) override {
+        out.append("team,programming,debugging,algorithm,total,members\n");
+    }
+    void team(size_t index, const vector<uint32_t>& members, const array<int, 3>& scores) override {
+        out.appendNumber(static_cast<long long>(index + 1));
+        for (int k = 0; k < 3; ++k) {
+            out.append(',');
+            out.appendNumber(scores[k]);
+        }
+        out.append(',');
+        out.appendNumber(scores[0] + scores[1] + scores[2]);
+        out.append(',');
+        appendMembers(members);
+    }
+    void end(const vector<uint32_t>& unassigned) override {
+        if (unassigned.empty()) return;
+        out.append("unassigned,,,,,");
+        appendMembers(unassigned);
+    }
+
+private:
+    // Same separator as the roster's preference lists
+    void appendMembers(const vector<uint32_t>& members) {
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (i > 0) out.append(';');
+            out.append(roster.student(members[i]).username);
+        }
+        out.append('\n');
+    }
+};
+
+class JsonTeamWriter : public TeamWriter {
+public:
+    JsonTeamWriter(const Roster& roster, OutputBuffer& out) : TeamWriter(roster, out) {}
+    void begin(size_t, size_t) override {
+        out.append("{\"teams\":[");
+        first = true;
+    }
+    void team(size_t index, const vector<uint32_t>& members, const array<int, 3>& scores) override {
+        out.append(first ? "\n{\"team\":" : ",\n{\"team\":");
+        first = false;
+        out.appendNumber(static_cast<long long>(index + 1));
+        out.append(",\"scores\":[");
+        for (int k = 0; k < 3; ++k) {
+            if (k > 0) out.append(',');
+            out.appendNumber(scores[k]);
+        }
+        out.append("],\"total\":");
+        out.appendNumber(scores[0] + scores[1] + scores[2]);
+        out.append(",\"members\":");
+        appendNames(members);
+        out.append('}');
+    }
+    void end(const vector<uint32_t>& unassigned) override {
+        out.append("\n],\"unassigned\":");
+        appendNames(unassigned);
+        out.append("}\n");
+    }
+
+private:
+    bool first = true;
+
+    void appendNames(const vector<uint32_t>& ids) {
+        out.append('[');
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (i > 0) out.append(',');
+            appendString(roster.student(ids[i]).username);
+        }
+        out.append(']');
+    }
+    void appendString(string_view text) {
+        static const char kHex[] = "0123456789abcdef";
+        out.append('"');
+        for (char c : text) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                out.append('\\');
+                out.append(c);
+            } else if (u < 0x20) {
+                out.append("\\u00");
+                out.append(kHex[u >> 4]);
+                out.append(kHex[u & 15]);
+            } else {
+                out.append(c);
+            }
+        }
+        out.append('"');
+    }
+};
+
+class BinaryTeamWriter : public TeamWriter {
+public:
+    BinaryTeamWriter(const Roster& roster, OutputBuffer& out) : TeamWriter(roster, out) {}
+    void begin(size_t team_count, size_t unassigned_count) override {
+        out.appendBytes(kTeamsMagic, sizeof(kTeamsMagic));
+        uint32_t header[4] = {kTeamsVersion, roster.size(), static_cast<uint32_t>(team_count),
+                              static_cast<uint32_t>(unassigned_count)};
+        out.appendBytes(header, sizeof(header));
+    }
+    void team(size_t, const vector<uint32_t>& members, const array<int, 3>& scores) override {
+        uint32_t size = static_cast<uint32_t>(members.size());
+        int32_t packed_scores[3] = {scores[0], scores[1], scores[2]};
+        out.appendBytes(&size, sizeof(size));
+        out.appendBytes(packed_scores, sizeof(packed_scores));
+        out.appendBytes(members.data(), members.size() * sizeof(uint32_t));
+    }
+    void end(const vector<uint32_t>& unassigned) override {
+        out.appendBytes(unassigned.data(), unassigned.size() * sizeof(uint32_t));
+    }
+};
+
+// The printTeamsAndScores listing
+class TextTeamWriter : public TeamWriter {
+public:
+    TextTeamWriter(const Roster& roster, OutputBuffer& out) : TeamWriter(roster, out) {}
+    void begin(size_t, size_t) override {}
+    void team(size_t index, const vector<uint32_t>& members, const array<int, 3>& scores) override {
+        out.append("Team ");
+        out.appendNumber(static_cast<long long>(index + 1));
+        out.append(":\n");
+        appendNames(members);
+        out.append("\nProgramming skill score: ");
+        out.appendNumber(scores[0]);
+        out.append(", Debugging skill score: ");
+        out.appendNumber(scores[1]);
+        out.append(", Algorithm skill score: ");
+        out.appendNumber(scores[2]);
+        out.append("\n\n");
+    }
+    void end(const vector<uint32_t>& unassigned) override {
+        if (unassigned.empty()) return;
+        out.append("Unassigned:\n");
+        appendNames(unassigned);
+        out.append("\n\n");
+    }
+
+private:
+    void appendNames(const vector<uint32_t>& ids) {
+        for (uint32_t id : ids) {
+            out.append(roster.student(id).username);
+            out.append(' ');
+        }
+    }
+};
+
+} // namespace
+
+unique_ptr<TeamWriter> makeTeamWriter(TeamFormat format, const Roster& roster, OutputBuffer& out) {
+    switch (format) {
+        case TeamFormat::CsvWithScores: return unique_ptr<TeamWriter>(new ScoresCsvTeamWriter(roster, out));
+        case TeamFormat::Json: return unique_ptr<TeamWriter>(new JsonTeamWriter(roster, out));
+        case TeamFormat::Binary: return unique_ptr<TeamWriter>(new BinaryTeamWriter(roster, out));
+        case TeamFormat::Text: return unique_ptr<TeamWriter>(new TextTeamWriter(roster, out));
+        default: return unique_ptr<TeamWriter>(new CsvTeamWriter(roster, out));
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef TEAMWRITER_HPP
+#define TEAMWRITER_HPP
+
+#include "Roster.hpp"
+#include <vector>
+#include <array>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <ostream>
+#include <cstdint>
+
+// Output formats for formed teams:
+//   Csv            "Team N,member,member," per team, then "Unassigned,..." (the original format)
+//   CsvWithScores  header row, then team,programming,debugging,algorithm,total,members (';'-separated)
+//   Json           {"teams":[{"team":N,"scores":[p,d,a],"total":T,"members":[...]}],"unassigned":[...]}
+//   Binary         native-endian: "TBTEAMS\0", u32 version, students, teams, unassigned; per team
+//                  u32 size, i32 scores[3], u32 member IDs; then u32 unassigned IDs
+//   Text           the printTeamsAndScores listing
+enum class TeamFormat { Csv, CsvWithScores, Json, Binary, Text };
+
+const char kTeamsMagic[8] = {'T', 'B', 'T', 'E', 'A', 'M', 'S', '\0'};
+const uint32_t kTeamsVersion = 1;
+
+// "csv", "scores", "json" or "binary"; false for anything else
+bool teamFormatFromName(std::string_view name, TeamFormat& format);
+// By extension: .json and .bin pick those formats, anything else plain CSV
+TeamFormat teamFormatForFile(const std::string& filename);
+// Extension for files in a format, without the dot
+const char* teamFormatExtension(TeamFormat format);
+
+struct WriteResult {
+    bool ok = true;
+    std::string error;  // The first failure, with the system's reason; empty when ok
+    size_t bytes = 0;
+};
+
+// Buffered output to a file descriptor or stream. Everything goes into one buffer allocated up front,
+// which is handed to the kernel whole each time it fills, so a file is written in a few large
+// writes no matter how small the pieces are. The first failure is kept and later output dropped.
+class OutputBuffer {
+public:
+    static const size_t kDefaultCapacity = 64 * 1024;
+
+    explicit OutputBuffer(size_t capacity = kDefaultCapacity);
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    // Create or truncate a file; the buffer closes it
+    bool open(const std::string& filename);
+    // Write to a descriptor the caller keeps open, such as a client socket
+    void attach(int descriptor);
+    // Write through a stream, such as cout, so the output stays in order with the stream's own
+    void attach(std::ostream& stream);
+
+    void append(std::string_view text);
+    void append(char c) {
+        if (used == buffer.size()) drain();
+        buffer[used++] = c;
+    }
+    void appendNumber(long long value);
+    void appendBytes(const void* data, size_t size) { append(std::string_view(static_cast<const char*>(data), size)); }
+
+    bool flush();
+    // Flush, close a file opened by open(), and report how it went
+    WriteResult finish();
+
+private:
+    std::vector<char> buffer;
+    size_t used = 0;
+    int fd = -1;
+    bool owns_fd = false;
+    std::ostream* stream = nullptr;
+    WriteResult result;
+
+    void drain();
+    void fail(const std::string& what);
+};
+
+// Writes teams in one format. Teams are handed over one at a time and each goes straight into
+// the buffer, so only the buffer's worth of output is ever held. TeamBuilder::writeTeams hands
+// them over after formation, once they are scored and sorted; nothing is written while teams
+// are still being formed.
+class TeamWriter {
+public:
+    virtual ~TeamWriter() = default;
+    // Called once, before the first team
+    virtual void begin(size_t team_count, size_t unassigned_count) = 0;
+    virtual void team(size_t index, const std::vector<uint32_t>& members, const std::array<int, 3>& scores) = 0;
+    // Called once, after the last team, even if nobody is unassigned
+    virtual void end(const std::vector<uint32_t>& unassigned) = 0;
+
+protected:
+    TeamWriter(const Roster& roster, OutputBuffer& out) : roster(roster), out(out) {}
+    const Roster& roster;
+    OutputBuffer& out;
+};
+
+std::unique_ptr<TeamWriter> makeTeamWriter(TeamFormat format, const Roster& roster, OutputBuffer& out);
+
+#endif // TEAMWRITER_HPP
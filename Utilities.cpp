@@ -1,7 +1,12 @@
 #include "Utilities.hpp"
 #include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -13,15 +18,130 @@ string toLowerCase(const string& str) {
 }
 
 int convertSkillLevel(const string& skill) {
-    string lower_skill = toLowerCase(skill);
-    if (lower_skill == "beginner") {
-        return 1;
-    } else if (lower_skill == "intermediate") {
-        return 2;
-    } else if (lower_skill == "advanced") {
-        return 3;
-    } else {
+    int level = skillLevelFromView(skill);
+    if (level == 0) {
         throw invalid_argument("Invalid skill level: " + skill);
     }
-    return -1; // Add a default return value to satisfy the compiler about returning an int on all paths
+    return level;
+}
+
+string_view trimView(string_view str) {
+    size_t start = 0;
+    size_t end = str.size();
+    while (start < end && isspace(static_cast<unsigned char>(str[start]))) {
+        start++;
+    }
+    while (end > start && isspace(static_cast<unsigned char>(str[end - 1]))) {
+        end--;
+    }
+    return str.substr(start, end - start);
+}
+
+void appendLowerCase(string& out, string_view str) {
+    size_t offset = out.size();
+    out.resize(offset + str.size());
+    for (size_t i = 0; i < str.size(); ++i) {
+        out[offset + i] = static_cast<char>(tolower(static_cast<unsigned char>(str[i])));
+    }
+}
+
+// Case-insensitive compare against a lowercase literal of the same length
+static bool equalsLower(string_view str, const char* lower) {
+    for (size_t i = 0; i < str.size(); ++i) {
+        if (tolower(static_cast<unsigned char>(str[i])) != lower[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int skillLevelFromView(string_view skill) {
+    // Length and first byte pick the only possible candidate, so each string is compared at most once
+    switch (skill.size()) {
+        case 8:
+            switch (skill[0] | 0x20) {
+                case 'b': return equalsLower(skill, "beginner") ? 1 : 0;
+                case 'a': return equalsLower(skill, "advanced") ? 3 : 0;
+                default: return 0;
+            }
+        case 12:
+            return equalsLower(skill, "intermediate") ? 2 : 0;
+        default:
+            return 0;
+    }
+}
+
+MappedFile::MappedFile(const string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0) {
+        address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            address = nullptr;
+            length = 0;
+            close(fd);
+            return;
+        }
+    }
+    close(fd);
+    is_open = true;
+}
+
+MappedFile::~MappedFile() {
+    if (address) {
+        munmap(address, length);
+    }
+}
+
+void MappedFile::adviseSequential() const {
+    if (address) {
+        madvise(address, length, MADV_SEQUENTIAL);
+    }
+}
+
+namespace {
+
+inline uint64_t rotateLeft(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+inline uint64_t mixWord(uint64_t word) {
+    word *= 0x87c37b91114253d5ULL;
+    word = rotateLeft(word, 31);
+    return word * 0x4cf5ad432745937fULL;
+}
+
+} // namespace
+
+uint64_t hashBytes(string_view data) {
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ (data.size() * 0xff51afd7ed558ccdULL);
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, data.data() + i, 8);
+        hash ^= mixWord(word);
+        hash = rotateLeft(hash, 27) * 5 + 0x52dce729;
+    }
+    uint64_t tail = 0;
+    // An empty view may have a null data pointer, which memcpy may not be given even for zero bytes
+    if (i < data.size()) {
+        memcpy(&tail, data.data() + i, data.size() - i);
+    }
+    hash ^= mixWord(tail);
+
+    // Final avalanche so every input bit reaches every output bit
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
 }
@@ -2,8 +2,69 @@
 #define UTILITIES_HPP
 
 #include <string>
+#include <limits>
+#include <type_traits>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <string_view>
+#include <cstdint>
 
 std::string toLowerCase(const std::string& str);
 int convertSkillLevel(const std::string& skill);
 
+// Strict parsing for command-line and request values: all of `text` must be one non-negative
+// number that fits the destination. Returns false and leaves `value` untouched otherwise.
+inline bool parseNumber(const std::string& text, double& value) {
+    if (text.empty() || !(std::isdigit(static_cast<unsigned char>(text[0])) || text[0] == '.')) return false;
+    char* end = nullptr;
+    double parsed = std::strtod(text.c_str(), &end);
+    if (*end != '\0' || !std::isfinite(parsed)) return false;
+    value = parsed;
+    return true;
+}
+
+template <typename T>
+bool parseNumber(const std::string& text, T& value) {
+    static_assert(std::is_integral<T>::value, "parseNumber reads a double or an integer");
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) return false;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed > static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+        return false;
+    }
+    value = static_cast<T>(parsed);
+    return true;
+}
+
+// Allocation-free helpers for the roster parser
+std::string_view trimView(std::string_view str);
+void appendLowerCase(std::string& out, std::string_view str);
+// Returns 0 for anything that is not beginner/intermediate/advanced (any case)
+int skillLevelFromView(std::string_view skill);
+
+// Read-only memory map of a whole file; an empty file opens with an empty view
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool opened() const { return is_open; }
+    std::string_view data() const { return std::string_view(static_cast<const char*>(address), length); }
+    // Hint that the mapping will be read front to back
+    void adviseSequential() const;
+
+private:
+    void* address = nullptr;
+    size_t length = 0;
+    bool is_open = false;
+};
+
+// 64-bit hash of a byte string, eight bytes per step (murmur-style mixing); not cryptographic
+uint64_t hashBytes(std::string_view data);
+
 #endif // UTILITIES_HPP
@@ -0,0 +1,259 @@
+#include "RosterGenerator.hpp"
+#include "../TeamBuilder.hpp"
+#include "../RosterSnapshot.hpp"
+#include "../Utilities.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <random>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+
+using namespace std;
+
+// Every heap allocation in the process, so each phase can report how many it made and how much they asked for
+static atomic<size_t> allocation_count(0);
+static atomic<size_t> allocation_bytes(0);
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    allocation_bytes.fetch_add(size, memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+// Kept out of line: once inlined next to a sized new, GCC mistakes the free for a mismatched deallocation
+[[gnu::noinline]] void operator delete(void* p) noexcept {
+    free(p);
+}
+
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+namespace {
+
+struct Sample {
+    size_t students;
+    string phase;
+    string mode;
+    double ms;
+    size_t teams;
+    size_t allocations;
+    size_t allocated_kb;
+    long peak_rss_kb;  // High-water mark of the whole process when the phase ended
+};
+
+// Start of a timed phase: wall clock plus the allocation count so far
+struct PhaseStart {
+    chrono::steady_clock::time_point time = chrono::steady_clock::now();
+    size_t allocations = allocation_count.load(memory_order_relaxed);
+    size_t bytes = allocation_bytes.load(memory_order_relaxed);
+};
+
+long peakRssKilobytes() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+Sample finish(const PhaseStart& start, size_t students, const string& phase, const string& mode, size_t teams) {
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start.time).count();
+    return {students, phase, mode, ms, teams, allocation_count.load(memory_order_relaxed) - start.allocations,
+            (allocation_bytes.load(memory_order_relaxed) - start.bytes) / 1024, peakRssKilobytes()};
+}
+
+string scratchPath(const string& name) {
+    const char* dir = getenv("TMPDIR");
+    return string(dir && *dir ? dir : "/tmp") + "/" + name;
+}
+
+void writeJson(ostream& out, const vector<Sample>& samples) {
+    out << "{\"benchmark\":\"teambuilder\",\"runs\":[";
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const Sample& s = samples[i];
+        out << (i == 0 ? "" : ",") << "\n  {\"students\":" << s.students << ",\"phase\":\"" << s.phase
+            << "\",\"mode\":\"" << s.mode << "\",\"ms\":" << s.ms << ",\"teams\":" << s.teams
+            << ",\"allocations\":" << s.allocations << ",\"allocated_kb\":" << s.allocated_kb
+            << ",\"peak_rss_kb\":" << s.peak_rss_kb << "}";
+    }
+    out << "\n]}\n";
+}
+
+void writeCsv(ostream& out, const vector<Sample>& samples) {
+    out << "students,phase,mode,ms,teams,allocations,allocated_kb,peak_rss_kb\n";
+    for (const auto& s : samples) {
+        out << s.students << "," << s.phase << "," << s.mode << "," << s.ms << "," << s.teams << "," << s.allocations
+            << "," << s.allocated_kb << "," << s.peak_rss_kb << "\n";
+    }
+}
+
+// Random incremental changes against formed teams: a third add a student, a third drop one and
+// a third rewrite someone's preference lists, each naming students already on the roster
+void applyChurn(TeamBuilder& builder, const vector<string>& new_names, uint64_t seed) {
+    mt19937_64 random(seed);
+    auto someone = [&]() {
+        const Roster& roster = builder.getRoster();
+        return string(roster.student(random() % roster.size()).username);
+    };
+    for (size_t i = 0; i < new_names.size(); ++i) {
+        if (i % 3 == 0) {
+            string want = someone();
+            string_view wants[1] = {want};
+            Student student;
+            student.username = new_names[i];
+            student.programming_skill = 1 + static_cast<int>(random() % 3);
+            student.debugging_skill = 1 + static_cast<int>(random() % 3);
+            student.algorithm_skill = 1 + static_cast<int>(random() % 3);
+            student.want_to_work_with = Span<string_view>(wants, 1);
+            builder.addStudent(student);
+        } else if (i % 3 == 1) {
+            builder.removeStudent(someone());
+        } else {
+            builder.updatePreferences(someone(), {someone(), someone()}, {someone()});
+        }
+    }
+}
+
+} // namespace
+
+// Parse a numeric option value, reporting the option when it is not a non-negative number that fits
+template <typename T>
+static bool parseOption(const string& key, const string& value, T& target) {
+    if (parseNumber(value, target)) return true;
+    cerr << "Invalid value for " << key << ": " << value << endl;
+    return false;
+}
+
+// Usage: bench [--sizes=1000,10000,...] [--team-size=N] [--format=json|csv] [--output=FILE]
+//              [--seed=N] [--pref-density=X] [--cluster-fraction=X] [--conflict-density=X]
+// Times parsing, roster construction, each formation mode, scoring, writing and a run of
+// incremental changes (up to 1000 adds, drops and preference updates) on generated rosters of each size.
+int main(int argc, char* argv[]) {
+    vector<size_t> sizes = {1000, 10000, 100000};
+    int team_size = 4;
+    string format = "json";
+    string output;
+    GeneratorOptions generator;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string value = eq == string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--sizes") {
+            sizes.clear();
+            stringstream list(value);
+            string item;
+            while (getline(list, item, ',')) {
+                if (item.empty()) continue;
+                size_t size = 0;
+                if (!parseOption(key, item, size)) return 1;
+                sizes.push_back(size);
+            }
+        } else if (key == "--team-size") {
+            if (!parseOption(key, value, team_size)) return 1;
+        } else if (key == "--format") {
+            format = value;
+        } else if (key == "--output") {
+            output = value;
+        } else if (key == "--seed") {
+            if (!parseOption(key, value, generator.seed)) return 1;
+        } else if (key == "--pref-density") {
+            if (!parseOption(key, value, generator.preference_density)) return 1;
+        } else if (key == "--cluster-fraction") {
+            if (!parseOption(key, value, generator.cluster_fraction)) return 1;
+        } else if (key == "--conflict-density") {
+            if (!parseOption(key, value, generator.conflict_density)) return 1;
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+
+    vector<Sample> samples;
+    for (size_t n : sizes) {
+        cerr << "Benchmarking " << n << " students..." << endl;
+        generator.students = n;
+        string roster_file = scratchPath("bench_roster_" + to_string(n) + ".csv");
+        string teams_file = scratchPath("bench_teams_" + to_string(n) + ".csv");
+        string snapshot_file = scratchPath("bench_roster_" + to_string(n) + ".roster");
+        {
+            ofstream file(roster_file);
+            writeRoster(file, generator);
+        }
+
+        PhaseStart start;
+        ParseResult parsed = parseRosterFile(roster_file);
+        samples.push_back(finish(start, n, "parse", "", 0));
+
+        start = PhaseStart();
+        shared_ptr<const Roster> roster = make_shared<const Roster>(move(parsed.students), move(parsed.arena));
+        samples.push_back(finish(start, n, "roster", "", 0));
+
+        // What a cached run pays instead of parse + roster
+        if (writeRosterSnapshot(snapshot_file, *roster, parsed.errors, 0, 0)) {
+            start = PhaseStart();
+            ResolvedRoster resolved;
+            vector<ParseError> errors;
+            if (readRosterSnapshot(snapshot_file, 0, 0, resolved, errors)) {
+                Roster cached(move(resolved));
+                samples.push_back(finish(start, n, "snapshot", "", 0));
+            }
+            remove(snapshot_file.c_str());
+        }
+
+        const char* modes[2] = {"skills", "preferences"};
+        for (int prefs = 0; prefs < 2; ++prefs) {
+            TeamBuilder builder(roster, team_size, prefs == 0);
+            builder.setVerbose(false);
+
+            start = PhaseStart();
+            builder.formTeams(prefs == 1);
+            size_t teams = builder.teamCount();
+            samples.push_back(finish(start, n, "form", modes[prefs], teams));
+
+            start = PhaseStart();
+            builder.calculateTeamScores();
+            samples.push_back(finish(start, n, "score", modes[prefs], teams));
+
+            start = PhaseStart();
+            builder.writeTeamsToFile(teams_file);
+            samples.push_back(finish(start, n, "write", modes[prefs], teams));
+
+            // Students joining, leaving and changing their lists after formation, repaired in place
+            vector<string> new_names(min<size_t>(n, 1000));
+            for (size_t i = 0; i < new_names.size(); ++i) {
+                new_names[i] = "joiner" + to_string(i) + ".bench";
+            }
+            start = PhaseStart();
+            applyChurn(builder, new_names, generator.seed);
+            samples.push_back(finish(start, n, "incremental", modes[prefs], builder.teamCount()));
+        }
+
+        remove(roster_file.c_str());
+        remove(teams_file.c_str());
+    }
+
+    ofstream file;
+    if (!output.empty()) {
+        file.open(output);
+        if (!file.is_open()) {
+            cerr << "Failed to open file for writing: " << output << endl;
+            return 1;
+        }
+    }
+    ostream& out = output.empty() ? cout : file;
+    if (format == "csv") {
+        writeCsv(out, samples);
+    } else {
+        writeJson(out, samples);
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "RosterGenerator.hpp"
+#include "../Utilities.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+
+using namespace std;
+
+// Parse a numeric option value, reporting the option when it is not a non-negative number that fits
+template <typename T>
+static bool parseOption(const string& key, const string& value, T& target) {
+    if (parseNumber(value, target)) return true;
+    cerr << "Invalid value for " << key << ": " << value << endl;
+    return false;
+}
+
+// Usage: gen_roster [--students=N] [--seed=N] [--skills=B,I,A] [--pref-density=X]
+//                   [--cluster-fraction=X] [--cluster-size=N] [--conflict-density=X] [--output=FILE]
+int main(int argc, char* argv[]) {
+    GeneratorOptions options;
+    string output;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq);
+        string value = eq == string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--students") {
+            if (!parseOption(key, value, options.students)) return 1;
+        } else if (key == "--seed") {
+            if (!parseOption(key, value, options.seed)) return 1;
+        } else if (key == "--skills") {
+            if (sscanf(value.c_str(), "%lf,%lf,%lf", &options.skill_weights[0], &options.skill_weights[1],
+                       &options.skill_weights[2]) != 3) {
+                cerr << "--skills expects three comma-separated weights" << endl;
+                return 1;
+            }
+        } else if (key == "--pref-density") {
+            if (!parseOption(key, value, options.preference_density)) return 1;
+        } else if (key == "--cluster-fraction") {
+            if (!parseOption(key, value, options.cluster_fraction)) return 1;
+        } else if (key == "--cluster-size") {
+            if (!parseOption(key, value, options.cluster_size)) return 1;
+        } else if (key == "--conflict-density") {
+            if (!parseOption(key, value, options.conflict_density)) return 1;
+        } else if (key == "--output") {
+            output = value;
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
+
+    if (output.empty()) {
+        writeRoster(cout, options);
+        return cout ? 0 : 1;
+    }
+    ofstream file(output);
+    if (!file.is_open()) {
+        cerr << "Failed to open file for writing: " << output << endl;
+        return 1;
+    }
+    writeRoster(file, options);
+    return file ? 0 : 1;
+}
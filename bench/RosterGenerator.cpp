@@ -0,0 +1,85 @@
+#include "RosterGenerator.hpp"
+#include "../Optimizer.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+const char* kSkillNames[3] = {"Beginner", "Intermediate", "Advanced"};
+
+string username(size_t index) {
+    // Mixed case so the parser's lowercasing is exercised
+    return "Stu" + to_string(index) + ".x";
+}
+
+// Whole part always, plus one more with probability equal to the fraction
+size_t sampleCount(Random& random, double mean) {
+    size_t count = static_cast<size_t>(mean);
+    if (random.unit() < mean - count) ++count;
+    return count;
+}
+
+const char* sampleSkill(Random& random, const double weights[3]) {
+    double total = weights[0] + weights[1] + weights[2];
+    double pick = random.unit() * total;
+    if (pick < weights[0]) return kSkillNames[0];
+    if (pick < weights[0] + weights[1]) return kSkillNames[1];
+    return kSkillNames[2];
+}
+
+} // namespace
+
+void writeRoster(ostream& out, const GeneratorOptions& options) {
+    Random random(options.seed);
+    size_t n = options.students;
+    uint32_t bound = static_cast<uint32_t>(max<size_t>(n, 1));
+
+    // Students [0, clustered) form cliques of cluster_size that all want each other
+    size_t cluster_size = max<size_t>(options.cluster_size, 2);
+    size_t clustered = static_cast<size_t>(n * options.cluster_fraction) / cluster_size * cluster_size;
+
+    out << "Username,Level of experience with C++?,Level of experience with gdb?,Level of experience in algorithms?,"
+           "students you do NOT want to work with?,students that you would like to work with?\n";
+
+    vector<size_t> wants;
+    for (size_t i = 0; i < n; ++i) {
+        out << username(i);
+        for (int k = 0; k < 3; ++k) {
+            out << ',' << sampleSkill(random, options.skill_weights);
+        }
+
+        // Conflicts never point inside the student's own clique
+        out << ',';
+        size_t conflicts = sampleCount(random, options.conflict_density);
+        size_t clique = i < clustered ? i / cluster_size : SIZE_MAX;
+        bool first = true;
+        for (size_t c = 0; c < conflicts; ++c) {
+            size_t other = random.below(bound);
+            if (other == i || (other < clustered && other / cluster_size == clique)) continue;
+            out << (first ? "" : ";") << username(other);
+            first = false;
+        }
+
+        out << ',';
+        wants.clear();
+        if (i < clustered) {
+            size_t start = clique * cluster_size;
+            for (size_t j = start; j < start + cluster_size; ++j) {
+                if (j != i) wants.push_back(j);
+            }
+        } else {
+            size_t count = sampleCount(random, options.preference_density);
+            for (size_t c = 0; c < count; ++c) {
+                size_t other = random.below(bound);
+                if (other != i) wants.push_back(other);
+            }
+        }
+        for (size_t w = 0; w < wants.size(); ++w) {
+            out << (w == 0 ? "" : ";") << username(wants[w]);
+        }
+        out << '\n';
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef ROSTERGENERATOR_HPP
+#define ROSTERGENERATOR_HPP
+
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+// Controls for synthetic rosters in the same CSV layout as data/
+struct GeneratorOptions {
+    size_t students = 1000;
+    uint64_t seed = 1;
+    double skill_weights[3] = {0.3, 0.5, 0.2};  // beginner, intermediate, advanced
+    double preference_density = 1.0;  // Average want_to_work_with entries per student
+    double cluster_fraction = 0.2;    // Share of students placed in mutual-preference cliques
+    size_t cluster_size = 3;
+    double conflict_density = 0.05;   // Average dont_want_to_work_with entries per student
+};
+
+void writeRoster(std::ostream& out, const GeneratorOptions& options);
+
+#endif // ROSTERGENERATOR_HPP
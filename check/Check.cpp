@@ -0,0 +1,464 @@
+#include "../bench/RosterGenerator.hpp"
+#include "../TeamBuilder.hpp"
+#include "../Portfolio.hpp"
+#include "../Anytime.hpp"
+#include "../RosterParser.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <random>
+#include <functional>
+#include <algorithm>
+#include <filesystem>
+
+using namespace std;
+
+namespace {
+
+size_t checks_run = 0;
+size_t checks_failed = 0;
+
+void expect(bool condition, const string& what, const string& where) {
+    ++checks_run;
+    if (!condition) {
+        ++checks_failed;
+        cerr << "FAIL " << where << ": " << what << "\n";
+    }
+}
+
+struct Layout {
+    FormationStatus status = FormationStatus::Infeasible;
+    vector<vector<uint32_t>> teams;
+    vector<uint32_t> unassigned;
+};
+
+const char* statusName(FormationStatus status) {
+    switch (status) {
+        case FormationStatus::Success: return "success";
+        case FormationStatus::Infeasible: return "infeasible";
+        default: return "budget exhausted";
+    }
+}
+
+// Every student on exactly one team or in the unassigned list, and no team holding a conflicting pair
+void checkMembership(const Roster& roster, const Layout& layout, const string& where) {
+    vector<int> seen(roster.size(), 0);
+    bool in_range = true;
+    for (const auto& team : layout.teams) {
+        for (uint32_t id : team) {
+            if (id < roster.size()) ++seen[id]; else in_range = false;
+        }
+    }
+    for (uint32_t id : layout.unassigned) {
+        if (id < roster.size()) ++seen[id]; else in_range = false;
+    }
+    expect(in_range, "team member outside the roster", where);
+    expect(all_of(seen.begin(), seen.end(), [](int count) { return count == 1; }),
+           "a student is missing or placed twice", where);
+
+    size_t conflicts = 0;
+    for (const auto& team : layout.teams) {
+        for (size_t i = 0; i < team.size(); ++i) {
+            for (size_t j = i + 1; j < team.size(); ++j) {
+                if (team[i] < roster.size() && team[j] < roster.size() && roster.hasConflict(team[i], team[j])) {
+                    ++conflicts;
+                }
+            }
+        }
+    }
+    expect(conflicts == 0, to_string(conflicts) + " conflicting pair(s) share a team", where);
+}
+
+vector<size_t> teamTargets(size_t students, size_t team_size) {
+    size_t num_teams = (students + team_size - 1) / team_size;
+    vector<size_t> targets;
+    for (size_t i = 0; i < num_teams; ++i) {
+        targets.push_back(students / num_teams + (i < students % num_teams ? 1 : 0));
+    }
+    return targets;
+}
+
+// Brute force over every split of a small roster into the team targets
+bool placeFrom(const Roster& roster, uint32_t id, const vector<size_t>& targets, vector<vector<uint32_t>>& teams) {
+    if (id == roster.size()) return true;
+    for (size_t i = 0; i < teams.size(); ++i) {
+        if (teams[i].size() >= targets[i]) continue;
+        if (any_of(teams[i].begin(), teams[i].end(), [&](uint32_t member) { return roster.hasConflict(id, member); })) {
+            continue;
+        }
+        teams[i].push_back(id);
+        bool placed = placeFrom(roster, id + 1, targets, teams);
+        teams[i].pop_back();
+        if (placed) return true;
+        // Empty teams of the same target are interchangeable
+        if (teams[i].empty() && (i + 1 == teams.size() || targets[i + 1] == targets[i])) break;
+    }
+    return false;
+}
+
+// Rosters too large to enumerate are taken to be feasible; the ones in data/ all are
+bool feasible(const Roster& roster, size_t team_size) {
+    if (roster.size() > 12) return true;
+    vector<size_t> targets = teamTargets(roster.size(), team_size);
+    vector<vector<uint32_t>> teams(targets.size());
+    return placeFrom(roster, 0, targets, teams);
+}
+
+// A complete formation has ceil(n / team_size) teams whose sizes differ by at most one. Where
+// no conflict-free split exists, every mode must say so.
+void checkFormation(const Roster& roster, size_t team_size, const Layout& layout, const string& where) {
+    if (!feasible(roster, team_size)) {
+        expect(layout.status == FormationStatus::Infeasible, string("status is ") + statusName(layout.status) +
+               " on a roster with no conflict-free split", where);
+        checkMembership(roster, layout, where);
+        return;
+    }
+    expect(layout.status == FormationStatus::Success, string("status is ") + statusName(layout.status), where);
+    checkMembership(roster, layout, where);
+    expect(layout.unassigned.empty(), to_string(layout.unassigned.size()) + " student(s) unassigned", where);
+
+    vector<size_t> expected = teamTargets(roster.size(), team_size);
+    expect(layout.teams.size() == expected.size(),
+           to_string(layout.teams.size()) + " teams, expected " + to_string(expected.size()), where);
+    vector<size_t> sizes;
+    for (const auto& team : layout.teams) {
+        sizes.push_back(team.size());
+    }
+    sort(sizes.begin(), sizes.end());
+    sort(expected.begin(), expected.end());
+    expect(sizes == expected, "team sizes do not match the targets", where);
+}
+
+Layout fromBuilder(const TeamBuilder& builder, FormationStatus status) {
+    Layout layout;
+    layout.status = status;
+    layout.teams = builder.teamMembers();
+    layout.unassigned = builder.unassignedStudents();
+    return layout;
+}
+
+Layout formWith(shared_ptr<const Roster> roster, size_t team_size, bool preferences,
+                const function<void(TeamBuilder&)>& configure) {
+    TeamBuilder builder(roster, static_cast<int>(team_size), !preferences);
+    builder.setVerbose(false);
+    configure(builder);
+    FormationStatus status = builder.formTeams(preferences);
+    return fromBuilder(builder, status);
+}
+
+// Form teams in every mode the program offers and check each layout
+void checkModes(const string& name, shared_ptr<const Roster> roster) {
+    OptimizerOptions optimize;
+    optimize.enabled = true;
+    optimize.iterations = 20000;
+    ExactOptions exact;
+    exact.enabled = true;
+    exact.time_limit_seconds = 0.5;
+    DecompositionOptions decompose;
+    decompose.enabled = true;
+    decompose.threads = 2;
+
+    for (size_t team_size = 3; team_size <= 5; ++team_size) {
+        if (roster->size() < team_size) continue;
+        for (bool preferences : {true, false}) {
+            string where = name + " size " + to_string(team_size) + (preferences ? " preferences" : " skills");
+            checkFormation(*roster, team_size, formWith(roster, team_size, preferences, [](TeamBuilder&) {}),
+                           where);
+            checkFormation(*roster, team_size, formWith(roster, team_size, preferences, [&](TeamBuilder& b) {
+                b.setOptimizerOptions(optimize);
+            }), where + " --optimize");
+            checkFormation(*roster, team_size, formWith(roster, team_size, preferences, [&](TeamBuilder& b) {
+                b.setExactOptions(exact);
+            }), where + " --exact");
+            checkFormation(*roster, team_size, formWith(roster, team_size, preferences, [&](TeamBuilder& b) {
+                b.setDecompositionOptions(decompose);
+            }), where + " --decompose");
+
+            PortfolioSearch portfolio(roster, static_cast<int>(team_size), !preferences);
+            portfolio.setOptimizerOptions(optimize);
+            PortfolioResult best = portfolio.run({1, 2, 3}, preferences, 2);
+            checkFormation(*roster, team_size, Layout{best.status, best.teams, best.unassigned}, where + " --starts");
+
+            AnytimeSearch anytime(roster, static_cast<int>(team_size), !preferences);
+            anytime.setOptimizerOptions(optimize);
+            AnytimeOptions deadline;
+            deadline.time_limit_seconds = 0.1;
+            anytime.start(preferences, deadline);
+            AnytimeResult result = anytime.wait();
+            checkFormation(*roster, team_size, Layout{result.status, result.teams, result.unassigned},
+                           where + " --anytime");
+        }
+    }
+}
+
+// A student's record with its own copies of the names, so the model outlives any roster
+struct ModelStudent {
+    string username;
+    int skills[3];
+    vector<string> wants;
+    vector<string> conflicts;
+};
+
+// The roster the incremental changes should have produced, built from scratch
+shared_ptr<const Roster> buildRoster(const vector<ModelStudent>& model) {
+    vector<vector<string_view>> wants(model.size()), conflicts(model.size());
+    vector<Student> students(model.size());
+    for (size_t i = 0; i < model.size(); ++i) {
+        wants[i].assign(model[i].wants.begin(), model[i].wants.end());
+        conflicts[i].assign(model[i].conflicts.begin(), model[i].conflicts.end());
+        students[i].username = model[i].username;
+        students[i].programming_skill = model[i].skills[0];
+        students[i].debugging_skill = model[i].skills[1];
+        students[i].algorithm_skill = model[i].skills[2];
+        students[i].want_to_work_with = Span<string_view>(wants[i].data(), wants[i].size());
+        students[i].dont_want_to_work_with = Span<string_view>(conflicts[i].data(), conflicts[i].size());
+    }
+    return make_shared<const Roster>(students);
+}
+
+vector<ModelStudent> modelOf(const Roster& roster) {
+    vector<ModelStudent> model;
+    for (const Student& s : roster.all()) {
+        ModelStudent m;
+        m.username = string(s.username);
+        m.skills[0] = s.programming_skill;
+        m.skills[1] = s.debugging_skill;
+        m.skills[2] = s.algorithm_skill;
+        for (string_view name : s.want_to_work_with) m.wants.emplace_back(name);
+        for (string_view name : s.dont_want_to_work_with) m.conflicts.emplace_back(name);
+        model.push_back(m);
+    }
+    return model;
+}
+
+vector<string> usernames(const Roster& roster, Span<uint32_t> ids) {
+    vector<string> names;
+    for (uint32_t id : ids) names.emplace_back(roster.student(id).username);
+    sort(names.begin(), names.end());
+    return names;
+}
+
+// Same students, skills and resolved adjacency, compared by username since IDs differ
+void checkSameRoster(const Roster& actual, const Roster& expected, const string& where) {
+    expect(actual.size() == expected.size(), "roster has " + to_string(actual.size()) + " students, expected " +
+           to_string(expected.size()), where);
+    size_t mismatched = 0;
+    for (uint32_t e = 0; e < expected.size(); ++e) {
+        const Student& want = expected.student(e);
+        uint32_t a = actual.find(want.username);
+        if (a == kNoStudent) {
+            ++mismatched;
+            continue;
+        }
+        const Student& got = actual.student(a);
+        bool same = got.id == a && got.programming_skill == want.programming_skill &&
+                    got.debugging_skill == want.debugging_skill && got.algorithm_skill == want.algorithm_skill &&
+                    usernames(actual, actual.wants(a)) == usernames(expected, expected.wants(e)) &&
+                    usernames(actual, actual.wantedBy(a)) == usernames(expected, expected.wantedBy(e)) &&
+                    usernames(actual, actual.conflicts(a)) == usernames(expected, expected.conflicts(e));
+        for (int column = 0; column < 3 && same; ++column) {
+            same = actual.skill(column, a) == expected.skill(column, e);
+        }
+        for (uint32_t other : expected.conflicts(e)) {
+            uint32_t mapped = actual.find(expected.student(other).username);
+            same = same && mapped != kNoStudent && actual.hasConflict(a, mapped) && actual.hasConflict(mapped, a);
+        }
+        if (!same) ++mismatched;
+    }
+    expect(mismatched == 0, to_string(mismatched) + " student(s) differ from a full rebuild", where);
+}
+
+// Cached team scores must match a fresh scoring of the same teams
+void checkScores(const TeamBuilder& builder, size_t team_size, const string& where) {
+    map<vector<uint32_t>, array<int, 3>> cached;
+    for (size_t i = 0; i < builder.teamCount(); ++i) {
+        vector<uint32_t> members = builder.teamMembers()[i];
+        sort(members.begin(), members.end());
+        cached[members] = builder.teamScores(i);
+    }
+    TeamBuilder fresh(make_shared<const Roster>(builder.getRoster()), static_cast<int>(team_size), false);
+    fresh.setVerbose(false);
+    fresh.setTeams(builder.teamMembers(), builder.unassignedStudents());
+    size_t stale = 0;
+    for (size_t i = 0; i < fresh.teamCount(); ++i) {
+        vector<uint32_t> members = fresh.teamMembers()[i];
+        sort(members.begin(), members.end());
+        auto found = cached.find(members);
+        if (found == cached.end() || found->second != fresh.teamScores(i)) ++stale;
+    }
+    expect(stale == 0, to_string(stale) + " team score(s) differ from a fresh scoring", where);
+}
+
+map<string, set<string>> teammatesByName(const TeamBuilder& builder) {
+    const Roster& roster = builder.getRoster();
+    map<string, set<string>> teammates;
+    for (const auto& team : builder.teamMembers()) {
+        for (uint32_t id : team) {
+            set<string>& mine = teammates[string(roster.student(id).username)];
+            for (uint32_t other : team) {
+                if (other != id) mine.insert(string(roster.student(other).username));
+            }
+        }
+    }
+    return teammates;
+}
+
+vector<string> pickNames(const vector<ModelStudent>& model, mt19937_64& random, size_t count) {
+    vector<string> names;
+    for (size_t i = 0; i < count && !model.empty(); ++i) {
+        names.push_back(model[random() % model.size()].username);
+    }
+    return names;
+}
+
+// Drive the incremental API through random adds, drops and preference changes, checking the
+// teams after every change and the roster against a full rebuild along the way
+void checkIncremental(const string& name, shared_ptr<const Roster> roster, size_t team_size, size_t changes) {
+    string where = name + " incremental size " + to_string(team_size);
+    vector<ModelStudent> model = modelOf(*roster);
+    const vector<ModelStudent> original = model;
+
+    // A second builder on the same roster must never see the changes
+    TeamBuilder witness(roster, static_cast<int>(team_size), false);
+    witness.setVerbose(false);
+    witness.formTeams(true);
+    const vector<vector<uint32_t>> witness_teams = witness.teamMembers();
+
+    TeamBuilder builder(roster, static_cast<int>(team_size), false);
+    builder.setVerbose(false);
+    checkFormation(*roster, team_size, fromBuilder(builder, builder.formTeams(true)), where + " initial");
+
+    mt19937_64 random(team_size * 7919 + roster->size());
+    size_t added = 0;
+    for (size_t step = 0; step < changes; ++step) {
+        string at = where + " change " + to_string(step + 1);
+        unsigned kind = random() % 3;
+        if (kind == 0 || model.size() <= team_size + 1) {
+            ModelStudent m;
+            m.username = "new" + to_string(added++) + ".check";
+            for (int& skill : m.skills) skill = 1 + static_cast<int>(random() % 3);
+            m.wants = pickNames(model, random, random() % 3);
+            // Sometimes name a student who has not joined yet, so the later add must link them
+            if (random() % 4 == 0) m.wants.push_back("new" + to_string(added) + ".check");
+            m.conflicts = pickNames(model, random, random() % 2);
+            vector<string_view> wants(m.wants.begin(), m.wants.end());
+            vector<string_view> conflicts(m.conflicts.begin(), m.conflicts.end());
+            Student student;
+            student.username = m.username;
+            student.programming_skill = m.skills[0];
+            student.debugging_skill = m.skills[1];
+            student.algorithm_skill = m.skills[2];
+            student.want_to_work_with = Span<string_view>(wants.data(), wants.size());
+            student.dont_want_to_work_with = Span<string_view>(conflicts.data(), conflicts.size());
+            expect(builder.addStudent(student), "add refused " + m.username, at);
+            expect(!builder.addStudent(student), "second add of " + m.username + " accepted", at);
+            model.push_back(m);
+        } else if (kind == 1) {
+            size_t index = random() % model.size();
+            string leaver = model[index].username;
+            // The last roster ID is renumbered into the leaver's slot; its team must follow it
+            const Roster& before = builder.getRoster();
+            string renumbered(before.student(before.size() - 1).username);
+            map<string, set<string>> teammates = teammatesByName(builder);
+            expect(builder.removeStudent(leaver), "remove refused " + leaver, at);
+            expect(!builder.removeStudent(leaver), "second remove of " + leaver + " accepted", at);
+            if (renumbered != leaver && builder.studentsMoved() == 0) {
+                // Nobody moved, so the renumbered student kept every teammate but the leaver; a
+                // student waiting unassigned may have taken the leaver's place
+                set<string> kept = teammates[renumbered];
+                kept.erase(leaver);
+                set<string> now = teammatesByName(builder)[renumbered];
+                expect(includes(now.begin(), now.end(), kept.begin(), kept.end()),
+                       "renumbered student " + renumbered + " changed teams", at);
+            }
+            model.erase(model.begin() + index);
+        } else {
+            ModelStudent& m = model[random() % model.size()];
+            m.wants = pickNames(model, random, random() % 3);
+            m.conflicts = pickNames(model, random, random() % 3);
+            m.conflicts.erase(remove(m.conflicts.begin(), m.conflicts.end(), m.username), m.conflicts.end());
+            expect(builder.updatePreferences(m.username, m.wants, m.conflicts), "update refused " + m.username, at);
+        }
+
+        Layout layout = fromBuilder(builder, FormationStatus::Success);
+        checkMembership(builder.getRoster(), layout, at);
+        size_t smallest = team_size, largest = 0;
+        for (const auto& team : layout.teams) {
+            smallest = min(smallest, team.size());
+            largest = max(largest, team.size());
+        }
+        expect(layout.teams.empty() || (largest <= team_size && largest - smallest <= 1),
+               "team sizes range from " + to_string(smallest) + " to " + to_string(largest), at);
+        if ((step + 1) % 50 == 0 || step + 1 == changes) {
+            checkSameRoster(builder.getRoster(), *buildRoster(model), at);
+            checkScores(builder, team_size, at);
+        }
+    }
+
+    // The shared roster and the other builder are untouched
+    checkSameRoster(*roster, *buildRoster(original), where + " shared roster");
+    expect(&witness.getRoster() == roster.get(), "the other builder lost the shared roster", where);
+    expect(witness.teamMembers() == witness_teams, "the other builder's teams changed", where);
+
+    // A full rebuild of the final roster is still formable, so nobody should be stranded for long
+    shared_ptr<const Roster> rebuilt = buildRoster(model);
+    Layout full = formWith(rebuilt, team_size, true, [](TeamBuilder&) {});
+    checkFormation(*rebuilt, team_size, full, where + " full rebuild");
+}
+
+shared_ptr<const Roster> loadRoster(const string& file) {
+    ParseResult parsed = parseRosterFile(file);
+    if (!parsed.opened || parsed.students.empty()) return nullptr;
+    return make_shared<const Roster>(move(parsed.students), move(parsed.arena));
+}
+
+shared_ptr<const Roster> generatedRoster(size_t students, uint64_t seed) {
+    GeneratorOptions options;
+    options.students = students;
+    options.seed = seed;
+    ostringstream csv;
+    writeRoster(csv, options);
+    string data = csv.str();
+    ParseResult parsed = parseRosterBuffer(data);
+    return make_shared<const Roster>(move(parsed.students), move(parsed.arena));
+}
+
+} // namespace
+
+// Usage: check [DATA_DIR]
+// Forms teams from every roster CSV in DATA_DIR (default data) in each mode and checks that no
+// team holds a conflicting pair and every team has its target size, then drives the incremental
+// API on those rosters and on generated dense and sparse ones, comparing it with a full rebuild.
+int main(int argc, char* argv[]) {
+    string data_dir = argc > 1 ? argv[1] : "data";
+    vector<string> files;
+    error_code error;
+    for (const auto& entry : filesystem::directory_iterator(data_dir, error)) {
+        if (entry.path().extension() == ".csv") files.push_back(entry.path().string());
+    }
+    if (error || files.empty()) {
+        cerr << "No roster CSVs found in " << data_dir << endl;
+        return 1;
+    }
+    sort(files.begin(), files.end());
+
+    for (const auto& file : files) {
+        shared_ptr<const Roster> roster = loadRoster(file);
+        expect(roster != nullptr, "no students read", file);
+        if (!roster) continue;
+        checkModes(file, roster);
+        for (size_t team_size = 3; team_size <= 4; ++team_size) {
+            checkIncremental(file, roster, team_size, 200);
+        }
+    }
+    // Past kDenseConflictLimit the conflict matrix and forbidden sets switch to sorted ID lists
+    checkIncremental("generated 500", generatedRoster(500, 1), 4, 500);
+    checkIncremental("generated 20000", generatedRoster(kDenseConflictLimit + 3616, 2), 4, 300);
+
+    cout << checks_run - checks_failed << " of " << checks_run << " checks passed." << endl;
+    return checks_failed == 0 ? 0 : 1;
+}
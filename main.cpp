@@ -1,82 +1,313 @@
 #include "TeamBuilder.hpp"
+#include "Portfolio.hpp"
+#include "Anytime.hpp"
+#include "Pareto.hpp"
+#include "RosterSnapshot.hpp"
+#include "Batch.hpp"
+#include "Evaluator.hpp"
+#include "Server.hpp"
+#include "Instrumentation.hpp"
 #include "Utilities.hpp"
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <vector>
+#include <memory>
+#include <fstream>
+#include <thread>
 #include <algorithm>
-#include <cctype>
 
 using namespace std;
 
-// Function to trim whitespace from both ends of a string
-std::string trim(const std::string& str) {
-    auto start = str.begin();
-    while (start != str.end() && std::isspace(*start)) {
-        start++;
+// Function to load the CSV as a Roster, from its snapshot when one is cached; malformed rows are
+// reported and skipped. Returns null when no students were read.
+shared_ptr<const Roster> readCSV(const string& filename, unsigned threads, const SnapshotOptions& snapshot_options) {
+    RosterLoad load = loadRoster(filename, threads, snapshot_options);
+    if (!load.opened) {
+        cerr << "Error opening file: " << filename << endl;
+    }
+    for (const auto& error : load.errors) {
+        cerr << filename << ":" << error.line << ": skipped row: " << error.message << "\n";
     }
+    return load.roster;
+}
 
-    auto end = str.end();
-    do {
-        end--;
-    } while (std::distance(start, end) > 0 && std::isspace(*end));
 
-    return std::string(start, end + 1);
+// Matches a flag whose value is optional: exactly "--name", or "--name=VALUE" with a non-empty VALUE
+static bool isOptionalValueFlag(const string& arg, const string& name) {
+    return arg.compare(0, name.size(), name) == 0 &&
+           (arg.size() == name.size() || (arg[name.size()] == '=' && arg.size() > name.size() + 1));
 }
 
-// Function to parse CSV and return a vector of Students
-vector<Student> readCSV(const string& filename) {
-    vector<Student> students;
-    ifstream file(filename);
-    string line;
-    if (file.is_open()) {
-        getline(file, line); // Skip the header line
-        while (getline(file, line)) {
-            stringstream ss(line);
-            Student student;
-            string skill, token, doNotWorkWith, workWith;
-
-            getline(ss, student.username, ',');
-            student.username = toLowerCase(trim(student.username));
-
-            getline(ss, skill, ',');
-            student.programming_skill = convertSkillLevel(trim(skill));
-            getline(ss, skill, ',');
-            student.debugging_skill = convertSkillLevel(trim(skill));
-            getline(ss, skill, ',');
-            student.algorithm_skill = convertSkillLevel(trim(skill));
-
-            // Read ';' as a separator for 'do not want to work with'
-            getline(ss, doNotWorkWith, ',');
-            stringstream dnwwStream(doNotWorkWith);
-            while (getline(dnwwStream, token, ';')) {
-                string trimmed_token = trim(token);
-                if (!trimmed_token.empty()) {
-                    student.dont_want_to_work_with.push_back(toLowerCase(trimmed_token));
-                }
+// Parse the number after "--flag=" (which ends at value_start) into value, reporting the flag
+// when the value is not a non-negative number that fits
+template <typename T>
+static bool parseFlagValue(const string& arg, size_t value_start, T& value) {
+    if (parseNumber(arg.substr(value_start), value)) return true;
+    cerr << "Invalid value for " << arg.substr(0, value_start - 1) << ": " << arg.substr(value_start) << endl;
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    // Optional flags: --optimize[=iterations] [--seed=N] [--starts=N] [--threads=N] [--quiet] [--stats[=FILE]]
+    //                 [--exact[=SECONDS]] (provably optimal preferences for rosters up to 64 students)
+    //                 [--decompose[=THREADS]] (preference teams formed per connected component, in parallel)
+    //                 [--anytime=SECONDS] (best teams found by a deadline, improving in the background)
+    //                 [--cache[=DIR]] (reuse a binary snapshot of each roster, kept in DIR or the user's cache
+    //                    directory; see RosterSnapshot.hpp) [--no-cache] (always parse the CSV; the default)
+    //                 [--output-format=csv|scores|json|binary] (default: from the output file's extension)
+    //                 [--weights=P,B[,M]] (optimize preferences, skill balance and teams meeting the minimum, weighted)
+    // Non-interactive: --batch=MANIFEST, or --roster=FILE --team-size=N --mode=preferences|skills --output=FILE
+    //                  or --roster=FILE --evaluate=TEAMS[,TEAMS...] (score team CSVs side by side)
+    //                  or --roster=FILE --team-size=N --mode=... --sweep[=STEPS] [--output=FILE] (Pareto front of
+    //                     the weightings in STEPS steps, default 4, each scaled by --weights; front teams go to
+    //                     FILE_1, FILE_2, ... by their row)
+    // Service: --serve=SOCKET [--cached-rosters=N] [--roster-dir=DIR] (answer requests on a Unix socket,
+    //          only for rosters inside DIR if given; see Server.hpp)
+    OptimizerOptions optimizer_options;
+    ExactOptions exact_options;
+    DecompositionOptions decomposition_options;
+    SnapshotOptions snapshot_options;
+    size_t starts = 1;
+    size_t sweep_steps = 0;
+    ObjectiveWeights weight_scale;
+    weight_scale.minimum = 1.0;
+    double anytime_seconds = 0.0;
+    unsigned threads = 0;
+    string manifest;
+    vector<string> layout_files;
+    ServerOptions server_options;
+    TeamFormat output_format = TeamFormat::Csv;
+    bool format_given = false;
+    BatchJob single_job;
+    bool quiet = false;
+    bool report_stats = false;
+    string stats_file;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (isOptionalValueFlag(arg, "--optimize")) {
+            optimizer_options.enabled = true;
+            if (arg.size() > 11 && arg[10] == '=') {
+                if (!parseFlagValue(arg, 11, optimizer_options.iterations)) return 1;
+            }
+        } else if (isOptionalValueFlag(arg, "--exact")) {
+            exact_options.enabled = true;
+            if (arg.size() > 8 && arg[7] == '=') {
+                if (!parseFlagValue(arg, 8, exact_options.time_limit_seconds)) return 1;
+            }
+        } else if (isOptionalValueFlag(arg, "--decompose")) {
+            decomposition_options.enabled = true;
+            if (arg.size() > 12 && arg[11] == '=') {
+                if (!parseFlagValue(arg, 12, decomposition_options.threads)) return 1;
+            }
+        } else if (arg.compare(0, 10, "--anytime=") == 0) {
+            if (!parseFlagValue(arg, 10, anytime_seconds)) return 1;
+        } else if (arg.compare(0, 7, "--seed=") == 0) {
+            if (!parseFlagValue(arg, 7, optimizer_options.seed)) return 1;
+        } else if (arg.compare(0, 9, "--starts=") == 0) {
+            if (!parseFlagValue(arg, 9, starts)) return 1;
+        } else if (arg.compare(0, 10, "--weights=") == 0) {
+            if (!parseObjectiveWeights(arg.substr(10), weight_scale)) {
+                cerr << "--weights needs two or three non-negative numbers, not all zero: " << arg.substr(10) << endl;
+                return 1;
+            }
+            applyWeights(weight_scale, optimizer_options);
+            optimizer_options.enabled = true;
+        } else if (isOptionalValueFlag(arg, "--sweep")) {
+            sweep_steps = 4;
+            if (arg.size() > 8 && arg[7] == '=') {
+                if (!parseFlagValue(arg, 8, sweep_steps)) return 1;
+                sweep_steps = max<size_t>(1, sweep_steps);
+            }
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            if (!parseFlagValue(arg, 10, threads)) return 1;
+        } else if (isOptionalValueFlag(arg, "--cache")) {
+            snapshot_options.enabled = true;
+            if (arg.size() > 8 && arg[7] == '=') {
+                snapshot_options.directory = arg.substr(8);
+            }
+        } else if (arg == "--no-cache") {
+            snapshot_options.enabled = false;
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (isOptionalValueFlag(arg, "--stats")) {
+            report_stats = true;
+            if (arg.size() > 8 && arg[7] == '=') {
+                stats_file = arg.substr(8);
+            }
+        } else if (arg.compare(0, 8, "--batch=") == 0) {
+            manifest = arg.substr(8);
+        } else if (arg.compare(0, 16, "--output-format=") == 0) {
+            if (!teamFormatFromName(arg.substr(16), output_format)) {
+                cerr << "Unknown output format: " << arg.substr(16) << endl;
+                return 1;
             }
+            format_given = true;
+        } else if (arg.compare(0, 8, "--serve=") == 0) {
+            server_options.socket_path = arg.substr(8);
+        } else if (arg.compare(0, 13, "--roster-dir=") == 0) {
+            server_options.roster_directory = arg.substr(13);
+        } else if (arg.compare(0, 17, "--cached-rosters=") == 0) {
+            if (!parseFlagValue(arg, 17, server_options.cached_rosters)) return 1;
+        } else if (arg.compare(0, 11, "--evaluate=") == 0) {
+            string list = arg.substr(11);
+            for (size_t start = 0; start <= list.size();) {
+                size_t comma = min(list.find(',', start), list.size());
+                if (comma > start) layout_files.push_back(list.substr(start, comma - start));
+                start = comma + 1;
+            }
+        } else if (arg.compare(0, 9, "--roster=") == 0) {
+            single_job.roster_file = arg.substr(9);
+        } else if (arg.compare(0, 12, "--team-size=") == 0) {
+            if (!parseFlagValue(arg, 12, single_job.team_size)) return 1;
+        } else if (arg.compare(0, 7, "--mode=") == 0) {
+            // Same spellings as a batch manifest's mode column
+            string mode = toLowerCase(arg.substr(7));
+            if (mode == "preferences" || mode == "1") {
+                single_job.prioritize_preferences = true;
+            } else if (mode == "skills" || mode == "0") {
+                single_job.prioritize_preferences = false;
+            } else {
+                cerr << "--mode must be preferences, skills, 1 or 0: " << arg.substr(7) << endl;
+                return 1;
+            }
+        } else if (arg.compare(0, 9, "--output=") == 0) {
+            single_job.output_file = arg.substr(9);
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+    }
 
-            // Read ';' as a separator for 'want to work with'
-            getline(ss, workWith, ',');
-            stringstream wwStream(workWith);
-            while (getline(wwStream, token, ';')) {
-                string trimmed_token = trim(token);
-                if (!trimmed_token.empty()) {
-                    student.want_to_work_with.push_back(toLowerCase(trimmed_token));
-                }
+    // Emit the run statistics on every exit path
+    struct StatsReport {
+        bool enabled;
+        string file;
+        ~StatsReport() {
+            if (!enabled) return;
+            if (file.empty()) {
+                stats::writeReport(cerr);
+                return;
             }
+            ofstream out(file);
+            if (out.is_open()) {
+                stats::writeReport(out);
+            } else {
+                cerr << "Failed to open file for writing: " << file << endl;
+            }
+        }
+    } stats_report{report_stats, stats_file};
 
-            students.push_back(student);
+    if (!server_options.socket_path.empty()) {
+        server_options.threads = threads;
+        server_options.snapshot_options = snapshot_options;
+        server_options.decomposition_options = decomposition_options;
+        return runServer(server_options);
+    }
+
+    if (!layout_files.empty()) {
+        if (single_job.roster_file.empty()) {
+            cerr << "--evaluate needs --roster." << endl;
+            return 1;
         }
-        file.close();
-    } else {
-        cerr << "Error opening file: " << filename << endl;
+        shared_ptr<const Roster> roster = readCSV(single_job.roster_file, 1, snapshot_options);
+        if (!roster) {
+            cerr << "No students found. Exiting." << endl;
+            return 1;
+        }
+        vector<Assignment> layouts(layout_files.size());
+        for (size_t i = 0; i < layout_files.size(); ++i) {
+            vector<ParseError> errors;
+            if (!readAssignment(layout_files[i], *roster, layouts[i], errors)) {
+                // An empty layout evaluates as invalid, so the file still gets its row
+                layouts[i] = Assignment();
+            }
+            for (const auto& error : errors) {
+                cerr << layout_files[i] << ":" << error.line << ": " << error.message << "\n";
+            }
+        }
+        AssignmentEvaluator evaluator(*roster);
+        printAssignmentMetrics(layout_files, evaluator.evaluate(layouts, threads));
+        return 0;
     }
-    return students;
-}
 
+    if (sweep_steps > 0) {
+        if (single_job.roster_file.empty() || single_job.team_size < 2) {
+            cerr << "--sweep needs --roster and a --team-size of at least 2." << endl;
+            return 1;
+        }
+        shared_ptr<const Roster> roster = readCSV(single_job.roster_file, threads, snapshot_options);
+        if (!roster) {
+            cerr << "No students found. Exiting." << endl;
+            return 1;
+        }
+        vector<ObjectiveWeights> weights = simplexWeights(sweep_steps);
+        for (auto& w : weights) {
+            w.preference *= weight_scale.preference;
+            w.balance *= weight_scale.balance;
+            w.minimum *= weight_scale.minimum;
+        }
+        ParetoSweep sweep(roster, single_job.team_size, !single_job.prioritize_preferences);
+        sweep.setOptimizerOptions(optimizer_options);
+        ParetoSweepResult result = sweep.run(weights, single_job.prioritize_preferences);
+        if (result.status == FormationStatus::Infeasible) {
+            cerr << "No valid team assignment exists for this roster. Exiting." << endl;
+            return 1;
+        }
+        printParetoPoints(result.points);
+
+        string output = single_job.output_file.empty() ? string("teams_pareto.") + teamFormatExtension(output_format)
+                                                       : single_job.output_file;
+        TeamFormat format = format_given ? output_format : teamFormatForFile(output);
+        size_t dot = output.rfind('.');
+        if (dot == string::npos || output.find('/', dot) != string::npos) dot = output.size();
+        size_t written = 0;
+        for (size_t i = 0; i < result.points.size(); ++i) {
+            if (!result.points[i].on_front) continue;
+            TeamBuilder builder(roster, single_job.team_size, !single_job.prioritize_preferences);
+            builder.setVerbose(false);
+            builder.setTeams(result.points[i].teams, result.unassigned);
+            string file = output.substr(0, dot) + "_" + to_string(i + 1) + output.substr(dot);
+            WriteResult write = builder.writeTeamsToFile(file, format);
+            if (!write.ok) {
+                cerr << "Failed to write " << file << ": " << write.error << endl;
+                return 1;
+            }
+            ++written;
+        }
+        cout << written << " of " << result.points.size() << " weighting(s) on the Pareto front." << endl;
+        return 0;
+    }
+
+    if (!manifest.empty() || !single_job.roster_file.empty()) {
+        vector<BatchJob> jobs;
+        if (!manifest.empty()) {
+            vector<ParseError> errors;
+            jobs = readManifest(manifest, errors);
+            for (const auto& error : errors) {
+                cerr << manifest << ":" << error.line << ": " << error.message << "\n";
+            }
+            if (format_given) {
+                for (auto& job : jobs) {
+                    job.output_format = output_format;
+                }
+            }
+        } else {
+            if (single_job.team_size < 2) {
+                cerr << "--roster needs --team-size of at least 2." << endl;
+                return 1;
+            }
+            if (single_job.output_file.empty()) {
+                single_job.output_file = string("teams_output.") + teamFormatExtension(output_format);
+            }
+            single_job.output_format = format_given ? output_format : teamFormatForFile(single_job.output_file);
+            jobs.push_back(single_job);
+        }
+        vector<BatchJobResult> results = runBatch(jobs, threads, optimizer_options, exact_options, decomposition_options,
+                                                   snapshot_options);
+        printBatchSummary(jobs, results);
+        bool all_ok = all_of(results.begin(), results.end(), [](const BatchJobResult& r) { return r.ok; });
+        return all_ok && !jobs.empty() ? 0 : 1;
+    }
 
-int main() {
     string filename;
     int team_size;
     bool prioritize_preferences;
@@ -109,27 +340,72 @@ int main() {
     cin >> prioritize_preferences;
 
     // Read students from the CSV file
-    vector<Student> students = readCSV(filename);
+    shared_ptr<const Roster> roster =
+        readCSV(filename, threads == 0 ? thread::hardware_concurrency() : threads, snapshot_options);
 
     // Check if any students were read
-    if (students.empty()) {
+    if (!roster) {
         cerr << "No students found. Exiting." << endl;
         return 1;
     }
 
-    TeamBuilder teamBuilder(students, team_size, !prioritize_preferences);
+    TeamBuilder teamBuilder(roster, team_size, !prioritize_preferences);
+    teamBuilder.setOptimizerOptions(optimizer_options);
+    teamBuilder.setExactOptions(exact_options);
+    teamBuilder.setDecompositionOptions(decomposition_options);
+    teamBuilder.setVerbose(!quiet);
 
     // Form teams based on the whether the user chose to group by skill or preferences
-    teamBuilder.formTeams(prioritize_preferences);
+    FormationStatus status;
+    if (anytime_seconds > 0) {
+        AnytimeSearch search(roster, team_size, !prioritize_preferences);
+        search.setOptimizerOptions(optimizer_options);
+        AnytimeOptions options;
+        options.time_limit_seconds = anytime_seconds;
+        options.seed = optimizer_options.seed;
+        double reported = 0.0;
+        if (!quiet) {
+            // Runs on the search thread; only rounds that improved on the last report are printed
+            options.on_progress = [&reported](const AnytimeProgress& progress) {
+                if (progress.rounds > 1 && progress.best_score <= reported) return;
+                reported = progress.best_score;
+                cout << "After " << progress.elapsed_seconds << " s: score " << progress.best_score << " ("
+                     << progress.rounds << " round(s), " << progress.iterations << " iteration(s))" << endl;
+            };
+        }
+        search.start(prioritize_preferences, options);
+        AnytimeResult best = search.wait();
+        cout << "Anytime search: best score " << best.score << " after " << best.progress.rounds << " round(s)" << endl;
+        teamBuilder.setTeams(best.teams, best.unassigned);
+        status = best.status;
+    } else if (starts > 1 && !exact_options.enabled) {
+        // Multi-start: seeds follow on from --seed so runs are reproducible
+        vector<uint64_t> seeds(starts);
+        for (size_t i = 0; i < starts; ++i) {
+            seeds[i] = optimizer_options.seed + i;
+        }
+        PortfolioSearch portfolio(roster, team_size, !prioritize_preferences);
+        portfolio.setOptimizerOptions(optimizer_options);
+        PortfolioResult best = portfolio.run(seeds, prioritize_preferences, threads);
+        cout << "Best of " << starts << " starts: seed " << best.seed << ", score " << best.score << endl;
+        teamBuilder.setTeams(best.teams, best.unassigned);
+        status = best.status;
+    } else {
+        status = teamBuilder.formTeams(prioritize_preferences);
+    }
+    if (status == FormationStatus::Infeasible) {
+        cerr << "No valid team assignment exists for this roster. Exiting." << endl;
+        return 1;
+    }
 
     // Print the teams and their scores
     teamBuilder.printTeamsAndScores();
 
-    // Write the teams to a CSV file
-    try {
-        teamBuilder.writeTeamsToFile("teams_output.csv");
-    } catch (const exception& e) {
-        cerr << "Error writing teams to file: " << e.what() << endl;
+    // Write the teams to a CSV file, or teams_output.json / .bin with --output-format
+    string output_file = string("teams_output.") + teamFormatExtension(output_format);
+    WriteResult written = teamBuilder.writeTeamsToFile(output_file, output_format);
+    if (!written.ok) {
+        cerr << "Failed to write " << output_file << ": " << written.error << endl;
         return 1;
     }
 